@@ -17,6 +17,10 @@
 #include <captainslog.h>
 #include <cstddef>
 
+#ifndef GAME_DLL
+#include "asciiatom.h"
+#endif
+
 namespace
 {
 const char *g_audio_priority_names[] = {"LOWEST", "LOW", "NORMAL", "HIGH", "CRITICAL"};
@@ -54,7 +58,12 @@ FieldParse AudioEventInfo::s_audioEventParseTable[] = {
  */
 void AudioEventInfo::Parse_Audio_Event(INI *ini)
 {
+#ifndef GAME_DLL
+    // Event names are copied into every AudioEventRTS that plays them, interning makes those copies free.
+    Utf8String name = Utf8Atom(ini->Get_Next_Token()).To_String();
+#else
     Utf8String name = ini->Get_Next_Token();
+#endif
     AudioEventInfo *new_event = g_theAudio->New_Audio_Event_Info(name);
 
     if (new_event != nullptr) {
@@ -15,6 +15,7 @@
 #include "commandline.h"
 #include "archivefilesystem.h"
 #include "globaldata.h"
+#include "ini.h"
 #include "localfilesystem.h"
 #include "version.h"
 #include <cstring>
@@ -186,6 +187,22 @@ int Parse_Use_Wave_Editor(char **argv, int argc)
     return 1;
 }
 
+#ifndef GAME_DLL
+int Parse_INI_Cache(char **argv, int argc)
+{
+    INI::Enable_Compiled_Cache(true);
+
+    return 1;
+}
+
+int Parse_INI_Parallel(char **argv, int argc)
+{
+    INI::Enable_Parallel_Load(true);
+
+    return 1;
+}
+#endif
+
 // Parses the command line passed to the executable via argc and argv.
 void Parse_Command_Line(int argc, char *argv[])
 {
@@ -203,7 +220,11 @@ void Parse_Command_Line(int argc, char *argv[])
         { "-mod", &Parse_Mod },
         { "-noshaders", &Parse_No_Shaders },
         { "-quickstart", &Parse_Quick_Start },
-        { "-useWaveEditor", &Parse_Use_Wave_Editor }
+        { "-useWaveEditor", &Parse_Use_Wave_Editor },
+#ifndef GAME_DLL
+        { "-iniCache", &Parse_INI_Cache },
+        { "-iniParallel", &Parse_INI_Parallel },
+#endif
     };
 
     // Starting with argument 1 (0 being the name of the binary in most cases)
@@ -18,7 +18,72 @@
 #include <captainslog.h>
 #include <cstring>
 
+#ifdef BUILD_WITH_ZLIB
+#include <zlib.h>
+#endif
+
 using std::memcmp;
+using std::memcpy;
+
+namespace
+{
+enum
+{
+    HEADER_SIZE = 8, // Four byte tag followed by the uncompressed size.
+};
+
+void Write_Header(void *dst, const char *tag, int size)
+{
+    uint8_t *putp = static_cast<uint8_t *>(dst);
+    int32_t le_size = htole32(size);
+    memcpy(putp, tag, 4);
+    memcpy(putp + 4, &le_size, sizeof(le_size));
+}
+
+#ifdef BUILD_WITH_ZLIB
+/**
+ * @brief Inflates a zlib stream straight into the destination buffer.
+ */
+int Zlib_Uncompress(const void *src, int src_size, void *dst, int dst_size)
+{
+    z_stream stream;
+    stream.next_in = static_cast<Bytef *>(const_cast<void *>(src));
+    stream.avail_in = src_size;
+    stream.next_out = static_cast<Bytef *>(dst);
+    stream.avail_out = dst_size;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+
+    if (inflateInit(&stream) != Z_OK) {
+        captainslog_error("Failed to initialise zlib: %s.\n", stream.msg != nullptr ? stream.msg : "unknown error");
+        return 0;
+    }
+
+    int result = inflate(&stream, Z_FINISH);
+    int out_length = int(stream.total_out);
+    inflateEnd(&stream);
+
+    if (result != Z_STREAM_END) {
+        captainslog_error("Failed to inflate zlib data, error %d.\n", result);
+        return 0;
+    }
+
+    return out_length;
+}
+
+int Zlib_Compress(const void *src, int src_size, void *dst, int dst_size, int level)
+{
+    uLongf out_length = dst_size;
+
+    if (compress2(static_cast<Bytef *>(dst), &out_length, static_cast<const Bytef *>(src), src_size, level) != Z_OK) {
+        return 0;
+    }
+
+    return int(out_length);
+}
+#endif
+} // namespace
 
 const char *CompressionManager::s_compressionNames[COMPRESSION_COUNT] = {
     "No compression",
@@ -126,11 +191,16 @@ int CompressionManager::Get_Uncompressed_Size(const void *data, int size)
         return size;
     }
 
-    return le32toh(static_cast<const int32_t *>(data)[1]);
+    // Headers read from files aren't always aligned.
+    int32_t size_le;
+    memcpy(&size_le, static_cast<const uint8_t *>(data) + 4, sizeof(size_le));
+
+    return le32toh(size_le);
 }
 
 /**
- * @brief Decompress possibly compressed data. Only handles RefPack compression.
+ * @brief Decompress possibly compressed data. zlib formats are only handled when built with zlib, the NOX, EAB and EAH
+ * formats of the original tools aren't handled at all.
  */
 int CompressionManager::Decompress_Data(void *src, int src_size, void *dst, int dst_size)
 {
@@ -138,14 +208,50 @@ int CompressionManager::Decompress_Data(void *src, int src_size, void *dst, int
         return 0;
     }
 
-    switch (Get_Compression_Type(src, src_size)) {
+    CompressionType type = Get_Compression_Type(src, src_size);
+    const uint8_t *data = static_cast<const uint8_t *>(src) + HEADER_SIZE;
+    int data_size = src_size - HEADER_SIZE;
+
+    switch (type) {
         case COMPRESSION_EAR: // RefPack
-            src_size -= 8;
-            return RefPack_Uncompress(dst, static_cast<const uint8_t *>(src) + 8, &src_size);
+            return RefPack_Uncompress_Checked(dst, dst_size, data, data_size);
+#ifdef BUILD_WITH_ZLIB
+        case COMPRESSION_ZL1:
+        case COMPRESSION_ZL2:
+        case COMPRESSION_ZL3:
+        case COMPRESSION_ZL4:
+        case COMPRESSION_ZL5:
+        case COMPRESSION_ZL6:
+        case COMPRESSION_ZL7:
+        case COMPRESSION_ZL8:
+        case COMPRESSION_ZL9:
+            return Zlib_Uncompress(data, data_size, dst, dst_size);
+#endif
 
         // Original game handles all these formats, ZH only appears to use RefPack however.
         case COMPRESSION_NONE:
         case COMPRESSION_NOX:
+        case COMPRESSION_EAB:
+        case COMPRESSION_EAH:
+        default:
+            captainslog_error("Compression format '%s' unhandled, file a bug report.\n", Get_Compression_Name(type));
+            break;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Get the buffer size Compress_Data needs to compress data of the given size, header included.
+ */
+int CompressionManager::Get_Max_Compressed_Size(int size, CompressionType type)
+{
+    switch (type) {
+        case COMPRESSION_NONE:
+            return size;
+        case COMPRESSION_EAR:
+            return HEADER_SIZE + RefPack_Max_Compressed_Size(size);
+#ifdef BUILD_WITH_ZLIB
         case COMPRESSION_ZL1:
         case COMPRESSION_ZL2:
         case COMPRESSION_ZL3:
@@ -155,11 +261,61 @@ int CompressionManager::Decompress_Data(void *src, int src_size, void *dst, int
         case COMPRESSION_ZL7:
         case COMPRESSION_ZL8:
         case COMPRESSION_ZL9:
-        case COMPRESSION_EAB:
-        case COMPRESSION_EAH:
+            return HEADER_SIZE + int(compressBound(size));
+#endif
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Compress data with a header Decompress_Data understands, returns the compressed size or 0 on failure.
+ *
+ * RefPack can split large data into blocks compressed on the given number of threads, the other formats ignore it.
+ */
+int CompressionManager::Compress_Data(
+    CompressionType type, void *src, int src_size, void *dst, int dst_size, int threads)
+{
+    if (dst_size < Get_Max_Compressed_Size(src_size, type)) {
+        captainslog_error("Buffer too small to compress with '%s'.\n", Get_Compression_Name(type));
+        return 0;
+    }
+
+    switch (type) {
+        case COMPRESSION_NONE:
+            memcpy(dst, src, src_size);
+            return src_size;
+        case COMPRESSION_EAR:
+            Write_Header(dst, "EAR", src_size);
+            return HEADER_SIZE
+                + RefPack_Compress_Threaded(static_cast<uint8_t *>(dst) + HEADER_SIZE, src, src_size, false, threads);
+#ifdef BUILD_WITH_ZLIB
+        case COMPRESSION_ZL1:
+        case COMPRESSION_ZL2:
+        case COMPRESSION_ZL3:
+        case COMPRESSION_ZL4:
+        case COMPRESSION_ZL5:
+        case COMPRESSION_ZL6:
+        case COMPRESSION_ZL7:
+        case COMPRESSION_ZL8:
+        case COMPRESSION_ZL9: {
+            int level = type - COMPRESSION_ZL1 + 1;
+            char tag[4] = { 'Z', 'L', char('0' + level), '\0' };
+            int size = Zlib_Compress(
+                src, src_size, static_cast<uint8_t *>(dst) + HEADER_SIZE, dst_size - HEADER_SIZE, level);
+
+            if (size == 0) {
+                return 0;
+            }
+
+            Write_Header(dst, tag, src_size);
+
+            return HEADER_SIZE + size;
+        }
+#endif
         default:
-            captainslog_error("Compression format '%s' unhandled, file a bug report.\n",
-                Get_Compression_Name(Get_Compression_Type(src, src_size)));
+            captainslog_error("Compression format '%s' can't be used to compress, file a bug report.\n",
+                Get_Compression_Name(type));
             break;
     }
 
@@ -42,6 +42,8 @@ public:
     static CompressionType Get_Compression_Type(const void *data, int size);
     static int Get_Uncompressed_Size(const void *data, int size);
     static int Decompress_Data(void *src, int src_size, void *dst, int dst_size);
+    static int Get_Max_Compressed_Size(int size, CompressionType type);
+    static int Compress_Data(CompressionType type, void *src, int src_size, void *dst, int dst_size, int threads = 1);
     static const char *Get_Compression_Name(CompressionType type) { return s_compressionNames[type]; }
 
 private:
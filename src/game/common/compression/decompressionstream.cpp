@@ -0,0 +1,175 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Incremental decoder for data compressed by the CompressionManager.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "decompressionstream.h"
+#include <captainslog.h>
+
+#ifdef BUILD_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+DecompressionStream::DecompressionStream() :
+    m_type(COMPRESSION_NONE),
+    m_uncompressedSize(0),
+    m_finished(false)
+#ifdef BUILD_WITH_ZLIB
+    ,
+    m_zlib(nullptr)
+#endif
+{
+}
+
+DecompressionStream::~DecompressionStream()
+{
+    End();
+}
+
+/**
+ * @brief Check if a format can be decoded a piece at a time.
+ */
+bool DecompressionStream::Can_Stream(CompressionType type)
+{
+    switch (type) {
+        case COMPRESSION_EAR:
+#ifdef BUILD_WITH_ZLIB
+        case COMPRESSION_ZL1:
+        case COMPRESSION_ZL2:
+        case COMPRESSION_ZL3:
+        case COMPRESSION_ZL4:
+        case COMPRESSION_ZL5:
+        case COMPRESSION_ZL6:
+        case COMPRESSION_ZL7:
+        case COMPRESSION_ZL8:
+        case COMPRESSION_ZL9:
+#endif
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Start decoding from the CompressionManager header, returns false if the format can't be streamed.
+ */
+bool DecompressionStream::Begin(const void *header, int header_size)
+{
+    End();
+    m_type = CompressionManager::Get_Compression_Type(header, header_size);
+
+    if (!Can_Stream(m_type)) {
+        return false;
+    }
+
+    m_uncompressedSize = CompressionManager::Get_Uncompressed_Size(header, header_size);
+
+    if (m_uncompressedSize < 0) {
+        return false;
+    }
+
+#ifdef BUILD_WITH_ZLIB
+    if (m_type != COMPRESSION_EAR) {
+        m_zlib = new z_stream;
+        m_zlib->next_in = Z_NULL;
+        m_zlib->avail_in = 0;
+        m_zlib->zalloc = Z_NULL;
+        m_zlib->zfree = Z_NULL;
+        m_zlib->opaque = Z_NULL;
+
+        if (inflateInit(m_zlib) != Z_OK) {
+            captainslog_error("Failed to initialise zlib: %s.\n", m_zlib->msg != nullptr ? m_zlib->msg : "unknown error");
+            delete m_zlib;
+            m_zlib = nullptr;
+
+            return false;
+        }
+
+        return true;
+    }
+#endif
+
+    m_refpack.Reset();
+
+    return true;
+}
+
+/**
+ * @brief Decode as much of src into dst as both allow, returns false if the data is invalid.
+ *
+ * The history bytes in front of dst must hold the end of the output decoded so far, at least HISTORY_SIZE bytes of it
+ * if there is that much. Input that isn't used has to be passed again with more data following it.
+ */
+bool DecompressionStream::Decode(
+    const void *src, int src_size, int *src_used, void *dst, int history, int dst_size, int *dst_used)
+{
+    *src_used = 0;
+    *dst_used = 0;
+
+    if (m_finished) {
+        return true;
+    }
+
+#ifdef BUILD_WITH_ZLIB
+    if (m_zlib != nullptr) {
+        m_zlib->next_in = static_cast<Bytef *>(const_cast<void *>(src));
+        m_zlib->avail_in = src_size;
+        m_zlib->next_out = static_cast<Bytef *>(dst);
+        m_zlib->avail_out = dst_size;
+
+        int result = inflate(m_zlib, Z_NO_FLUSH);
+        *src_used = src_size - int(m_zlib->avail_in);
+        *dst_used = dst_size - int(m_zlib->avail_out);
+
+        if (result == Z_STREAM_END) {
+            m_finished = true;
+
+            return int(m_zlib->total_out) == m_uncompressedSize;
+        }
+
+        // A buffer error only means no progress was possible with what was passed in.
+        if (result != Z_OK && result != Z_BUF_ERROR) {
+            captainslog_error("Failed to inflate zlib data, error %d.\n", result);
+            return false;
+        }
+
+        return true;
+    }
+#endif
+
+    if (m_type != COMPRESSION_EAR) {
+        return false;
+    }
+
+    bool ok = m_refpack.Decode(src, src_size, src_used, dst, history, dst_size, dst_used);
+    m_finished = m_refpack.Finished();
+
+    return ok;
+}
+
+/**
+ * @brief Release the decoder state.
+ */
+void DecompressionStream::End()
+{
+#ifdef BUILD_WITH_ZLIB
+    if (m_zlib != nullptr) {
+        inflateEnd(m_zlib);
+        delete m_zlib;
+        m_zlib = nullptr;
+    }
+#endif
+
+    m_type = COMPRESSION_NONE;
+    m_uncompressedSize = 0;
+    m_finished = false;
+}
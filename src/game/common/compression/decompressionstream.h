@@ -0,0 +1,58 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Incremental decoder for data compressed by the CompressionManager.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "compressionmanager.h"
+#include "refpack.h"
+
+#ifdef BUILD_WITH_ZLIB
+struct z_stream_s;
+#endif
+
+/**
+ * Decodes RefPack and zlib data as it arrives so the output can be consumed through a bounded window instead of
+ * decompressing the whole thing at once. Other formats need all of their input and can't be streamed.
+ */
+class DecompressionStream
+{
+public:
+    enum
+    {
+        HEADER_SIZE = 8,
+        HISTORY_SIZE = RefPackDecoder::HISTORY_SIZE, // Output the window must keep in front of new data.
+    };
+
+    DecompressionStream();
+    ~DecompressionStream();
+
+    bool Begin(const void *header, int header_size);
+    bool Decode(const void *src, int src_size, int *src_used, void *dst, int history, int dst_size, int *dst_used);
+    void End();
+    bool Finished() const { return m_finished; }
+    CompressionType Get_Compression_Type() const { return m_type; }
+    int Get_Uncompressed_Size() const { return m_uncompressedSize; }
+
+    static bool Can_Stream(CompressionType type);
+
+private:
+    CompressionType m_type;
+    int m_uncompressedSize;
+    bool m_finished;
+    RefPackDecoder m_refpack;
+#ifdef BUILD_WITH_ZLIB
+    z_stream_s *m_zlib;
+#endif
+};
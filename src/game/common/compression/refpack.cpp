@@ -14,333 +14,670 @@
  */
 #include "refpack.h"
 #include <algorithm>
-#include <cstdlib>
 #include <cstring>
+#include <vector>
+
+#ifndef GAME_DLL
+#include <atomic>
+#include <thread>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
-using std::malloc;
 using std::max;
 using std::memcpy;
 using std::memset;
 using std::min;
 
+namespace
+{
+enum
+{
+    HASH_SIZE = 65536,
+    WINDOW_SIZE = 131072,
+    MAX_DISTANCE = WINDOW_SIZE - 1,
+    MIN_MATCH = 3,
+    MAX_MATCH = 1028,
+    MAX_LITERALS = 112,
+    MAX_CHAIN = 128, // Chain links followed per position, bounds the time spent on very repetitive data.
+    QUICK_MAX_CHAIN = 16,
+    NICE_MATCH = 128, // Matches this long end the search early.
+    MAX_LAZY_MATCH = 32, // Matches this long are taken without looking for a better one at the next byte.
+    LAZY_CHAIN_DIVISOR = 4, // The lazy search only needs to find the better matches so it is cut shorter.
+    MIN_THREADED_BLOCK = 256 * 1024,
+    COPY_SLACK = 16, // Bytes the decoder may write past a match when copying whole blocks.
+};
+
 /**
- * Utility function for compression for checking length of matching data.
+ * Hash chains for the match finder, positions are stored with a bias that grows with every use so entries left over
+ * from an earlier call are always out of range and the tables never need clearing between calls.
  */
-static uint32_t RefPack_Matchlen(const uint8_t *s, const uint8_t *d, uint32_t maxmatch)
+struct RefPackScratch
+{
+    RefPackScratch() : bias(0), last_end(0) {}
+
+    void Begin(int end)
+    {
+        if (hashtbl.empty()) {
+            hashtbl.resize(HASH_SIZE);
+            link.resize(WINDOW_SIZE);
+        }
+
+        if (bias == 0 || int64_t(bias) + last_end + 1 + end > INT32_MAX) {
+            memset(hashtbl.data(), 0, sizeof(int32_t) * HASH_SIZE);
+            bias = 1;
+        } else {
+            bias += last_end + 1;
+        }
+
+        last_end = end;
+    }
+
+    std::vector<int32_t> hashtbl;
+    std::vector<int32_t> link;
+    int32_t bias;
+    int last_end;
+};
+
+#ifndef GAME_DLL
+thread_local RefPackScratch s_refpackScratch;
+#endif
+
+struct RefPackMatch
+{
+    int length;
+    int offset; // Distance back minus one as stored in the commands.
+    int cost;
+
+    int Gain() const { return length - cost; }
+};
+
+inline int Count_Trailing_Zeros(uint64_t value)
 {
-    uint32_t current;
+#if defined _MSC_VER && defined _M_X64
+    unsigned long index;
+    _BitScanForward64(&index, value);
 
-    for (current = 0; current < maxmatch && *s++ == *d++; ++current);
+    return int(index);
+#elif defined _MSC_VER
+    unsigned long index;
 
-    return current;
+    if (_BitScanForward(&index, uint32_t(value))) {
+        return int(index);
+    }
+
+    _BitScanForward(&index, uint32_t(value >> 32));
+
+    return int(index) + 32;
+#else
+    return __builtin_ctzll(value);
+#endif
 }
 
 /**
- * Compresses data using refpack LZ method
+ * Length of the match between two positions, compared a word at a time.
  */
-static int RefPack_Encode(const void *src, int src_len, void *dst, int dst_len, bool quick)
+inline int Match_Length(const uint8_t *s, const uint8_t *d, int max_match)
 {
-    int32_t len;
-    uint32_t tlen;
-    uint32_t tcost;
-    uint32_t run;
-    uint32_t toffset;
-    uint32_t boffset;
-    uint32_t blen;
-    uint32_t bcost;
-    uint32_t mlen;
-    const uint8_t *tptr;
-    const uint8_t *getp;
-    const uint8_t *runp;
-    uint8_t *putp;
+    int length = 0;
 
-    int countliterals = 0;
-    int countshort = 0;
-    int countlong = 0;
-    int countvlong = 0;
-    int32_t hash;
-    int32_t hoffset;
-    int32_t minhoffset;
-    int i;
-    int32_t *link;
-    int32_t *hashtbl;
-    int32_t *hashptr;
-
-    len = src_len;
-    putp = static_cast<uint8_t *>(dst);
-    run = 0;
-    getp = runp = static_cast<const uint8_t *>(src);
-
-    hashtbl = static_cast<int32_t *>(malloc(sizeof(int32_t) * 65536));
-    link = static_cast<int32_t *>(malloc(sizeof(int32_t) * 131072));
-    hashptr = hashtbl;
-    memset(hashtbl, 0xFF, sizeof(int32_t) * 65536);
-
-    while (len > 0) {
-        boffset = 0;
-        blen = bcost = 2;
-        mlen = min(len, 1028);
-        tptr = getp - 1;
-        hash = 0x10 * getp[1] ^ (uint16_t)(getp[2] | ((uint16_t)getp[0] << 8));
-        hoffset = hashtbl[hash];
-        minhoffset = max(intptr_t(getp - static_cast<const uint8_t *>(src) - 131071), intptr_t(0));
-
-        if (hoffset >= minhoffset) {
-            do {
-                tptr = static_cast<const uint8_t *>(src) + hoffset;
+#if !defined __BYTE_ORDER__ || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; length + 8 <= max_match; length += 8) {
+        uint64_t a;
+        uint64_t b;
+        memcpy(&a, s + length, sizeof(a));
+        memcpy(&b, d + length, sizeof(b));
 
-                if (getp[blen] == tptr[blen]) {
-                    tlen = RefPack_Matchlen(getp, tptr, mlen);
+        if (a != b) {
+            return length + (Count_Trailing_Zeros(a ^ b) >> 3);
+        }
+    }
+#endif
 
-                    if (tlen > blen) {
-                        toffset = (getp - 1) - tptr;
+    while (length < max_match && s[length] == d[length]) {
+        ++length;
+    }
 
-                        if (toffset < 1024 && tlen <= 10) { // two byte long form
-                            tcost = 2;
-                        } else if (toffset < 16384 && tlen <= 67) { // three byte long form
-                            tcost = 3;
-                        } else { // four byte very long form
-                            tcost = 4;
-                        }
+    return length;
+}
 
-                        if (tlen - tcost + 4 > blen - bcost + 4) {
-                            blen = tlen;
-                            bcost = tcost;
-                            boffset = toffset;
+inline int Hash(const uint8_t *p)
+{
+    return (0x10 * p[1]) ^ uint16_t(p[2] | (uint16_t(p[0]) << 8));
+}
 
-                            if (blen >= 1028) {
-                                break;
-                            }
+inline int Match_Cost(int offset, int length)
+{
+    if (offset < 1024 && length <= 10) {
+        return 2;
+    }
+
+    if (offset < 16384 && length <= 67) {
+        return 3;
+    }
+
+    return 4;
+}
+
+/**
+ * Writes literal blocks until fewer than 4 literals are left, those go with the next command.
+ */
+uint8_t *Write_Literals(uint8_t *putp, const uint8_t *&runp, int &run)
+{
+    while (run > 3) {
+        int length = min(int(MAX_LITERALS), run & ~3);
+        run -= length;
+        *putp++ = uint8_t(0xE0 + (length >> 2) - 1);
+        memcpy(putp, runp, length);
+        runp += length;
+        putp += length;
+    }
+
+    return putp;
+}
+
+uint8_t *Write_Match(uint8_t *putp, const uint8_t *runp, int run, const RefPackMatch &match)
+{
+    putp = Write_Literals(putp, runp, run);
+
+    if (match.cost == 2) { // two byte short form
+        *putp++ = uint8_t(((match.offset >> 8) << 5) + ((match.length - 3) << 2) + run);
+        *putp++ = uint8_t(match.offset);
+    } else if (match.cost == 3) { // three byte medium form
+        *putp++ = uint8_t(0x80 + (match.length - 4));
+        *putp++ = uint8_t((run << 6) + (match.offset >> 8));
+        *putp++ = uint8_t(match.offset);
+    } else { // four byte long form
+        *putp++ = uint8_t(0xC0 + ((match.offset >> 16) << 4) + (((match.length - 5) >> 8) << 2) + run);
+        *putp++ = uint8_t(match.offset >> 8);
+        *putp++ = uint8_t(match.offset);
+        *putp++ = uint8_t(match.length - 5);
+    }
+
+    memcpy(putp, runp, run);
+
+    return putp + run;
+}
+
+uint8_t *Write_End(uint8_t *putp, const uint8_t *runp, int run)
+{
+    putp = Write_Literals(putp, runp, run);
+    *putp++ = uint8_t(0xFC + run); // end of stream command + 0..3 literal
+
+    // Empty input may come with a null pointer.
+    if (run > 0) {
+        memcpy(putp, runp, run);
+    }
+
+    return putp + run;
+}
+
+/**
+ * Parses part of the data into matches, matches never reach back before begin so parts can be encoded independently.
+ * The emitter is called with the literal run before each match, returns the length of the literal run at the end.
+ */
+template<typename Emitter>
+int RefPack_Parse(RefPackScratch &scratch, const uint8_t *src, int begin, int end, bool quick, Emitter &emit)
+{
+    scratch.Begin(end);
+    int32_t *hashtbl = scratch.hashtbl.data();
+    int32_t *link = scratch.link.data();
+    const int32_t bias = scratch.bias;
+    const int max_chain = quick ? QUICK_MAX_CHAIN : MAX_CHAIN;
+    int pos = begin;
+    int run_start = begin;
+
+    // Only positions with enough data left to hash are inserted.
+    auto insert = [&](int at) {
+        if (at + MIN_MATCH <= end) {
+            int hash = Hash(src + at);
+            link[at & (WINDOW_SIZE - 1)] = hashtbl[hash];
+            hashtbl[hash] = at + bias;
+        }
+    };
+
+    auto find = [&](int at, RefPackMatch &best, int chain_limit) {
+        const uint8_t *getp = src + at;
+        int max_match = min(end - at, int(MAX_MATCH));
+        int min_pos = max(at - int(MAX_DISTANCE), begin);
+        int candidate = hashtbl[Hash(getp)] - bias;
+        best.length = 2;
+        best.cost = 2;
+        best.offset = 0;
+
+        for (int depth = 0; candidate >= min_pos && depth < chain_limit; ++depth) {
+            const uint8_t *tptr = src + candidate;
+
+            if (best.length < max_match && tptr[best.length] == getp[best.length]) {
+                int length = Match_Length(getp, tptr, max_match);
+
+                if (length > best.length) {
+                    int offset = at - candidate - 1;
+                    int cost = Match_Cost(offset, length);
+
+                    if (length - cost > best.Gain()) {
+                        best.length = length;
+                        best.cost = cost;
+                        best.offset = offset;
+
+                        if (length >= min(max_match, int(NICE_MATCH))) {
+                            break;
                         }
                     }
                 }
-            } while ((hoffset = link[hoffset & 131071]) >= minhoffset);
+            }
+
+            candidate = link[candidate & (WINDOW_SIZE - 1)] - bias;
         }
 
-        if (bcost >= blen) {
-            hoffset = (getp - static_cast<const uint8_t *>(src));
-            link[hoffset & 131071] = hashtbl[hash];
-            hashtbl[hash] = hoffset;
+        return best.Gain() > 0;
+    };
 
-            ++run;
-            ++getp;
-            --len;
-        } else {
-            while (run > 3) {// literal block of data
-                tlen = min((uint32_t)112, run & ~3);
-                run -= tlen;
-                *putp++ = (unsigned char)(0xe0 + (tlen >> 2) - 1);
-                memcpy(putp, runp, tlen);
-                runp += tlen;
-                putp += tlen;
-                ++countliterals;
-            }
+    while (pos + MIN_MATCH <= end) {
+        RefPackMatch match;
 
-            if (bcost == 2) // two byte long form
-            {
-                *putp++ = (unsigned char)(((boffset >> 8) << 5) + ((blen - 3) << 2) + run);
-                *putp++ = (unsigned char)boffset;
-                ++countshort;
-            } else if (bcost == 3) { //three byte long form
-                *putp++ = (unsigned char)(0x80 + (blen - 4));
-                *putp++ = (unsigned char)((run << 6) + (boffset >> 8));
-                *putp++ = (unsigned char)boffset;
-                ++countlong;
-            } else { // four byte very long form
-                *putp++ = (unsigned char)(0xc0 + ((boffset >> 16) << 4) + (((blen - 5) >> 8) << 2) + run);
-                *putp++ = (unsigned char)(boffset >> 8);
-                *putp++ = (unsigned char)(boffset);
-                *putp++ = (unsigned char)(blen - 5);
-                ++countvlong;
-            }
+        if (!find(pos, match, max_chain)) {
+            insert(pos++);
+            continue;
+        }
+
+        insert(pos);
 
-            if (run) {
-                memcpy(putp, runp, run);
-                putp += run;
-                run = 0;
+        // Lazy matching, a literal is cheaper than missing a better match starting at the next byte.
+        while (!quick && match.length < MAX_LAZY_MATCH && pos + 1 + MIN_MATCH <= end) {
+            RefPackMatch next;
+
+            if (!find(pos + 1, next, max_chain / LAZY_CHAIN_DIVISOR) || next.Gain() <= match.Gain()) {
+                break;
             }
 
-            if (quick) {
-                hoffset = (getp - static_cast<const uint8_t *>(src));
-                link[hoffset & 131071] = hashtbl[hash];
-                hashtbl[hash] = hoffset;
-                getp += blen;
-            } else {
-                for (i = 0; i < (int)blen; ++i) {
-                    hash = 0x10 * getp[1] ^ (uint16_t)(getp[2] | ((uint16_t)getp[0] << 8));
-                    hoffset = (getp - static_cast<const uint8_t *>(src));
-                    link[hoffset & 131071] = hashtbl[hash];
-                    hashtbl[hash] = hoffset;
-                    ++getp;
-                }
+            insert(++pos);
+            match = next;
+        }
+
+        emit(src + run_start, pos - run_start, match);
+
+        if (quick) {
+            pos += match.length;
+        } else {
+            for (int i = 1; i < match.length; ++i) {
+                insert(pos + i);
             }
 
-            runp = getp;
-            len -= blen;
+            pos += match.length;
         }
-    }
 
-    while (run > 3) // no match at end, use literal
-    {
-        tlen = min((uint32_t)112, run & ~3);
-        run -= tlen;
-        *putp++ = (unsigned char)(0xe0 + (tlen >> 2) - 1);
-        memcpy(putp, runp, tlen);
-        runp += tlen;
-        putp += tlen;
+        run_start = pos;
     }
 
-    *putp++ = (unsigned char)(0xFC + run); // end of stream command + 0..3 literal
-    if (run) {
-        memcpy(putp, runp, run);
-        putp += run;
+    return end - run_start;
+}
+
+int Write_Header(uint8_t *putp, int size)
+{
+    if (size < 0xFFFFFF) {
+        putp[0] = 0x10;
+        putp[1] = 0xFB;
+        putp[2] = (unsigned)(size & 0xFF0000) >> 16;
+        putp[3] = (unsigned)(size & 0xFF00) >> 8;
+        putp[4] = (unsigned)(size & 0xFF);
+
+        return 5;
     }
 
-    free(link);
-    free(hashtbl);
+    putp[0] = 0x90;
+    putp[1] = 0xFB;
+    putp[2] = (unsigned)(size & 0xFF000000) >> 24;
+    putp[3] = (unsigned)(size & 0xFF0000) >> 16;
+    putp[4] = (unsigned)(size & 0xFF00) >> 8;
+    putp[5] = (unsigned)(size & 0xFF);
 
-    return putp - static_cast<uint8_t *>(dst);
+    return 6;
 }
 
-/**
- * Decompresses EA's proprietary "RefPack" format.
- */
-int RefPack_Uncompress(void *dst, const void *src, int *size)
+struct RefPackWriter
 {
-    const uint8_t *getp;
-    uint8_t *ref;
+    void operator()(const uint8_t *runp, int run, const RefPackMatch &match)
+    {
+        putp = Write_Match(putp, runp, run, match);
+    }
+
     uint8_t *putp;
-    uint8_t first;
-    uint8_t second;
-    uint8_t third;
-    uint8_t forth;
-    uint16_t flags;
-    uint32_t run;
-    int out_length = 0;
+};
 
-    if (src == nullptr) {
-        if (size != nullptr) {
-            *size = 0;
+#ifndef GAME_DLL
+/**
+ * Output of one independently parsed block. The first match is kept back as the literals before it can only be
+ * written once the literals left at the end of the previous block are known.
+ */
+struct RefPackBlock
+{
+    void operator()(const uint8_t *runp, int run, const RefPackMatch &match)
+    {
+        if (!has_match) {
+            has_match = true;
+            lead_run = run;
+            first_match = match;
+        } else {
+            size_t size = data.size();
+            data.resize(size + run + run / MAX_LITERALS + 8);
+            data.resize(Write_Match(&data[size], runp, run, match) - data.data());
         }
-
-        return 0;
     }
 
-    getp = static_cast<const uint8_t *>(src);
+    std::vector<uint8_t> data;
+    bool has_match;
+    int lead_run;
+    RefPackMatch first_match;
+    int tail_run;
+};
+#endif
 
-    // This flag and size reading section appears to differe between different RefPack versions.
-    flags = (getp[0] << 8) | getp[1];
-    getp += 2;
+/**
+ * Copies a back reference. When the output has room to spare the copy is done in whole 16 or 8 byte blocks which may
+ * write a few bytes past the match, those are overwritten by whatever is decoded next.
+ */
+inline uint8_t *Copy_Match(uint8_t *putp, int distance, int length, const uint8_t *put_end)
+{
+    const uint8_t *ref = putp - distance;
+    uint8_t *end = putp + length;
 
-    if (flags & 0x8000) {
-        if (flags & 0x0100) {
-            getp += 6;
+    if (put_end - end >= COPY_SLACK) {
+        // Each block only reads bytes written before it so overlapping references still repeat correctly.
+        if (distance >= 16) {
+            do {
+                memcpy(putp, ref, 16);
+                putp += 16;
+                ref += 16;
+            } while (putp < end);
+
+            return end;
+        }
+
+        if (distance >= 8) {
+            do {
+                memcpy(putp, ref, 8);
+                putp += 8;
+                ref += 8;
+            } while (putp < end);
+
+            return end;
         }
+    }
 
-        out_length = (getp[0] << 24) | (getp[1] << 16) | (getp[2] << 8) | getp[3];
-        getp += 4;
+    if (distance == 1) {
+        memset(putp, *ref, length);
+    } else if (distance >= length) {
+        memcpy(putp, ref, length);
+    } else {
+        while (putp < end) {
+            *putp++ = *ref++;
+        }
+    }
+
+    return end;
+}
+
+/**
+ * Copies a literal run, in whole 16 byte blocks when both buffers have room to spare. The end of the input is only
+ * known to the checked decoder, the unchecked one passes getp as get_end so the copy is always exact.
+ */
+inline uint8_t *Copy_Literals(uint8_t *putp, const uint8_t *getp, int run, const uint8_t *put_end, const uint8_t *get_end)
+{
+    uint8_t *end = putp + run;
+
+    if (put_end - end >= COPY_SLACK && get_end - getp >= run + COPY_SLACK) {
+        do {
+            memcpy(putp, getp, 16);
+            putp += 16;
+            getp += 16;
+        } while (putp < end);
+    } else if (run > 3) {
+        memcpy(putp, getp, run);
     } else {
-        if (flags & 0x0100) {
-            getp += 5;
+        // Runs in front of matches are at most 3 bytes, too short for a library call to pay off.
+        while (putp < end) {
+            *putp++ = *getp++;
         }
+    }
+
+    return end;
+}
+
+/**
+ * Reads the stream header, returns its size or 0 if src is too short to hold it.
+ */
+int Read_Header(const uint8_t *src, int src_size, uint32_t &out_length)
+{
+    if (src_size < 2) {
+        return 0;
+    }
+
+    // This flag and size reading section appears to differ between different RefPack versions.
+    int flags = (src[0] << 8) | src[1];
+    int size_bytes = (flags & 0x8000) ? 4 : 3;
+    int header_size = 2 + ((flags & 0x0100) ? size_bytes + 2 : 0) + size_bytes;
+
+    if (src_size < header_size) {
+        return 0;
+    }
+
+    out_length = 0;
 
-        out_length = (getp[0] << 16) | (getp[1] << 8) | getp[2];
-        getp += 3;
+    for (const uint8_t *getp = src + header_size - size_bytes; getp < src + header_size; ++getp) {
+        out_length = (out_length << 8) | *getp;
     }
 
-    putp = static_cast<uint8_t *>(dst);
+    return header_size;
+}
+
+/**
+ * Runs RefPack commands until the end marker. The checked version validates every read and write, stops in front of
+ * any command that doesn't fit in what is left of src or dst and returns false for invalid data. The unchecked
+ * version trusts the stream like the original game does. References may reach back as far as put_start.
+ */
+template<bool checked>
+bool Decode_Commands(const uint8_t *&src, const uint8_t *get_end, uint8_t *&dst, const uint8_t *put_start,
+    const uint8_t *put_end, bool &finished)
+{
+    const uint8_t *getp = src;
+    uint8_t *putp = dst;
+    bool ok = true;
 
     while (true) {
-        first = *getp++;
+        const uint8_t *command = getp;
+
+        if (checked && getp == get_end) {
+            break;
+        }
+
+        int first = *getp++;
+        int run;
+        int distance;
+        int length;
 
-        // Short command.
         if (!(first & 0x80)) {
-            second = *getp++;
+            // Short command.
+            if (checked && get_end - getp < 1) {
+                getp = command;
+                break;
+            }
+
             run = first & 3;
+            distance = (((first & 0x60) << 3) | getp[0]) + 1;
+            length = ((first & 0x1c) >> 2) + 3;
+            getp += 1;
+        } else if (!(first & 0x40)) {
+            // Medium command.
+            if (checked && get_end - getp < 2) {
+                getp = command;
+                break;
+            }
 
-            while (run--) {
-                *putp++ = *getp++;
+            run = getp[0] >> 6;
+            distance = (((getp[0] & 0x3f) << 8) | getp[1]) + 1;
+            length = (first & 0x3f) + 4;
+            getp += 2;
+        } else if (!(first & 0x20)) {
+            // Long command.
+            if (checked && get_end - getp < 3) {
+                getp = command;
+                break;
             }
 
-            ref = putp - 1 - (((first & 0x60) << 3) + second);
-            run = ((first & 0x1c) >> 2) + 3 - 1;
+            run = first & 3;
+            distance = (((first & 0x10) << 12) | (getp[0] << 8) | getp[1]) + 1;
+            length = (((first & 0x0c) << 6) | getp[2]) + 5;
+            getp += 3;
+        } else {
+            // Byte command, or the end marker with a run of up to 3 bytes.
+            bool end_marker = ((first & 0x1f) << 2) + 4 > MAX_LITERALS;
+            run = end_marker ? first & 3 : ((first & 0x1f) << 2) + 4;
+
+            if (checked && (get_end - getp < run || put_end - putp < run)) {
+                getp = command;
+                break;
+            }
 
-            do {
-                *putp++ = *ref++;
-            } while (run--);
+            putp = Copy_Literals(putp, getp, run, put_end, checked ? get_end : getp);
+            getp += run;
+
+            if (end_marker) {
+                finished = true;
+                break;
+            }
 
             continue;
         }
 
-        // Medium command.
-        if (!(first & 0x40)) {
-            second = *getp++;
-            third = *getp++;
-            run = second >> 6;
+        if (checked && (get_end - getp < run || put_end - putp < run + length)) {
+            getp = command;
+            break;
+        }
 
-            while (run--) {
-                *putp++ = *getp++;
-            }
+        if (checked && putp + run - put_start < distance) {
+            ok = false;
+            break;
+        }
 
-            ref = putp - 1 - (((second & 0x3f) << 8) + third);
+        putp = Copy_Literals(putp, getp, run, put_end, checked ? get_end : getp);
+        getp += run;
+        putp = Copy_Match(putp, distance, length, put_end);
+    }
 
-            run = (first & 0x3f) + 4 - 1;
+    src = getp;
+    dst = putp;
 
-            do {
-                *putp++ = *ref++;
-            } while (run--);
+    return ok;
+}
+} // namespace
 
-            continue;
+/**
+ * Decompresses EA's proprietary "RefPack" format.
+ */
+int RefPack_Uncompress(void *dst, const void *src, int *size)
+{
+    if (src == nullptr) {
+        if (size != nullptr) {
+            *size = 0;
         }
 
-        // Long command.
-        if (!(first & 0x20)) {
-            second = *getp++;
-            third = *getp++;
-            forth = *getp++;
-            run = first & 3;
+        return 0;
+    }
 
-            while (run--) {
-                *putp++ = *getp++;
-            }
+    const uint8_t *getp = static_cast<const uint8_t *>(src);
+    uint32_t out_length;
+    getp += Read_Header(getp, INT32_MAX, out_length);
 
-            ref = putp - 1 - (((first & 0x10) >> 4 << 16) + (second << 8) + third);
+    uint8_t *putp = static_cast<uint8_t *>(dst);
+    bool finished = false;
+    Decode_Commands<false>(getp, nullptr, putp, putp, putp + out_length, finished);
 
-            run = ((first & 0x0c) >> 2 << 8) + forth + 5 - 1;
+    if (size != nullptr) {
+        *size = int(getp - static_cast<const uint8_t *>(src));
+    }
 
-            do {
-                *putp++ = *ref++;
-            } while (run--);
+    return int(out_length);
+}
 
-            continue;
-        }
+/**
+ * Decompresses EA's proprietary "RefPack" format from untrusted data, returns the uncompressed size or 0 if the data
+ * is invalid or doesn't fit in dst.
+ */
+int RefPack_Uncompress_Checked(void *dst, int dst_size, const void *src, int src_size)
+{
+    if (src == nullptr || dst == nullptr) {
+        return 0;
+    }
 
-        // Byte command.
-        run = ((first & 0x1f) << 2) + 4;
+    RefPackDecoder decoder;
+    int src_used;
+    int dst_used;
 
-        if (run <= 112) {
-            while (run--) {
-                *putp++ = *getp++;
-            }
+    if (!decoder.Decode(src, src_size, &src_used, dst, 0, dst_size, &dst_used) || !decoder.Finished()) {
+        return 0;
+    }
 
-            continue;
-        }
+    return dst_used;
+}
 
-        // End marker and possibly run of up to 3 bytes.
-        run = first & 3;
+/**
+ * Starts decoding a new stream.
+ */
+void RefPackDecoder::Reset()
+{
+    m_outLength = 0;
+    m_written = 0;
+    m_headerRead = false;
+    m_finished = false;
+}
 
-        while (run--) {
-            *putp++ = *getp++;
+/**
+ * Decodes as much of src into dst as both allow, returns false if the data is invalid. The history bytes in front of
+ * dst must hold the end of the output decoded so far, at least HISTORY_SIZE bytes of it if there is that much.
+ */
+bool RefPackDecoder::Decode(
+    const void *src, int src_size, int *src_used, void *dst, int history, int dst_size, int *dst_used)
+{
+    const uint8_t *getp = static_cast<const uint8_t *>(src);
+    uint8_t *start = static_cast<uint8_t *>(dst);
+    uint8_t *putp = start;
+    *src_used = 0;
+    *dst_used = 0;
+
+    if (!m_headerRead) {
+        uint32_t out_length;
+        int header_size = Read_Header(getp, src_size, out_length);
+
+        if (header_size == 0) {
+            return true;
         }
 
-        break;
+        if (out_length > INT32_MAX) {
+            return false;
+        }
+
+        getp += header_size;
+        m_outLength = int(out_length);
+        m_headerRead = true;
     }
 
-    if (size != nullptr) {
-        *size = getp - static_cast<const uint8_t *>(src);
+    if (m_finished) {
+        *src_used = int(getp - static_cast<const uint8_t *>(src));
+        return true;
     }
 
-    return out_length;
+    const uint8_t *get_end = static_cast<const uint8_t *>(src) + src_size;
+    const uint8_t *put_end = start + min(dst_size, m_outLength - m_written);
+    bool ok = Decode_Commands<true>(getp, get_end, putp, start - history, put_end, m_finished);
+
+    *src_used = int(getp - static_cast<const uint8_t *>(src));
+    *dst_used = int(putp - start);
+    m_written += *dst_used;
+
+    return ok && (!m_finished || m_written == m_outLength);
 }
 
 /**
@@ -349,24 +686,101 @@ int RefPack_Uncompress(void *dst, const void *src, int *size)
 int RefPack_Compress(void *dst, const void *src, int size, bool quick)
 {
     uint8_t *putp = static_cast<uint8_t *>(dst);
-    int header_len = 0;
+    putp += Write_Header(putp, size);
+    RefPackWriter writer = { putp };
 
-    if (size < 0xFFFFFF) {
-        putp[0] = 0x10;
-        putp[1] = 0xFB;
-        putp[2] = (unsigned)(size & 0xFF0000) >> 16;
-        putp[3] = (unsigned)(size & 0xFF00) >> 8;
-        putp[4] = (unsigned)(size & 0xFF);
-        header_len = 5;
-    } else {
-        putp[0] = 0x90;
-        putp[1] = 0xFB;
-        putp[2] = (unsigned)(size & 0xFF000000) >> 24;
-        putp[3] = (unsigned)(size & 0xFF0000) >> 16;
-        putp[4] = (unsigned)(size & 0xFF00) >> 8;
-        putp[5] = (unsigned)(size & 0xFF);
-        header_len = 6;
+#ifdef GAME_DLL
+    RefPackScratch scratch;
+    int run = RefPack_Parse(scratch, static_cast<const uint8_t *>(src), 0, size, quick, writer);
+#else
+    int run = RefPack_Parse(s_refpackScratch, static_cast<const uint8_t *>(src), 0, size, quick, writer);
+#endif
+
+    putp = Write_End(writer.putp, static_cast<const uint8_t *>(src) + size - run, run);
+
+    return putp - static_cast<uint8_t *>(dst);
+}
+
+/**
+ * Compresses to the "RefPack" format splitting the data into blocks that are parsed on several threads. Matches
+ * don't cross blocks so the result is a little larger than from RefPack_Compress but decodes the same way.
+ */
+int RefPack_Compress_Threaded(void *dst, const void *src, int size, bool quick, int threads)
+{
+#ifdef GAME_DLL
+    return RefPack_Compress(dst, src, size, quick);
+#else
+    int block_size = max(int(MIN_THREADED_BLOCK), (size + threads - 1) / max(threads, 1));
+    int block_count = (size + block_size - 1) / block_size;
+
+    if (threads <= 1 || block_count <= 1) {
+        return RefPack_Compress(dst, src, size, quick);
+    }
+
+    const uint8_t *getp = static_cast<const uint8_t *>(src);
+    std::vector<RefPackBlock> blocks(block_count);
+    std::atomic<int> next_block(0);
+
+    auto worker = [&]() {
+        for (int i = next_block++; i < block_count; i = next_block++) {
+            RefPackBlock &block = blocks[i];
+            int begin = i * block_size;
+            int end = min(begin + block_size, size);
+            block.has_match = false;
+            block.data.reserve(end - begin + (end - begin) / MAX_LITERALS + 16);
+            block.tail_run = RefPack_Parse(s_refpackScratch, getp, begin, end, quick, block);
+        }
+    };
+
+    std::vector<std::thread> pool;
+
+    for (int i = 1; i < min(threads, block_count); ++i) {
+        pool.emplace_back(worker);
+    }
+
+    worker();
+
+    for (std::thread &thread : pool) {
+        thread.join();
     }
 
-    return header_len + RefPack_Encode(src, size, &putp[header_len], 0x20000, quick);
+    // Literals left at the end of one block join the literals before the first match of the next.
+    uint8_t *putp = static_cast<uint8_t *>(dst);
+    putp += Write_Header(putp, size);
+    const uint8_t *runp = getp;
+    int run = 0;
+
+    for (int i = 0; i < block_count; ++i) {
+        RefPackBlock &block = blocks[i];
+        int end = min((i + 1) * block_size, size);
+
+        if (!block.has_match) {
+            run += block.tail_run;
+            continue;
+        }
+
+        putp = Write_Match(putp, runp, run + block.lead_run, block.first_match);
+
+        if (!block.data.empty()) {
+            memcpy(putp, block.data.data(), block.data.size());
+            putp += block.data.size();
+        }
+
+        runp = getp + end - block.tail_run;
+        run = block.tail_run;
+    }
+
+    putp = Write_End(putp, runp, run);
+
+    return putp - static_cast<uint8_t *>(dst);
+#endif
+}
+
+/**
+ * Gets the dst size the RefPack compressors need for any data of the given size.
+ */
+int RefPack_Max_Compressed_Size(int size)
+{
+    // Matches are only used when they save space, the worst case is literal blocks with a command byte each.
+    return 6 + size + size / MAX_LITERALS + 1;
 }
@@ -17,4 +17,31 @@
 #include "always.h"
 
 int RefPack_Uncompress(void *dst, const void *src, int *size);
+int RefPack_Uncompress_Checked(void *dst, int dst_size, const void *src, int src_size);
 int RefPack_Compress(void *dst, const void *src, int size, bool quick);
+int RefPack_Compress_Threaded(void *dst, const void *src, int size, bool quick, int threads);
+int RefPack_Max_Compressed_Size(int size);
+
+/**
+ * Decodes "RefPack" data a piece at a time so it can be streamed through a bounded window.
+ */
+class RefPackDecoder
+{
+public:
+    enum
+    {
+        HISTORY_SIZE = 131072, // Furthest back a reference can reach.
+    };
+
+    RefPackDecoder() : m_outLength(0), m_written(0), m_headerRead(false), m_finished(false) {}
+
+    void Reset();
+    bool Decode(const void *src, int src_size, int *src_used, void *dst, int history, int dst_size, int *dst_used);
+    bool Finished() const { return m_finished; }
+
+private:
+    int m_outLength;
+    int m_written;
+    bool m_headerRead;
+    bool m_finished;
+};
@@ -19,6 +19,7 @@
 #include "commandline.h"
 #include "commandlist.h"
 #include "filesystem.h"
+#include "framearena.h"
 #include "functionlexicon.h"
 #include "gamelod.h"
 #include "gametext.h"
@@ -66,7 +67,15 @@ GameEngine::~GameEngine()
 
 void GameEngine::Reset() {}
 
-void GameEngine::Update() {}
+void GameEngine::Update()
+{
+    // TODO update subsystems.
+
+#ifndef GAME_DLL
+    // Anything allocated from the frame arena during this tick is reclaimed in one go.
+    FrameArena::End_Frame();
+#endif
+}
 
 void GameEngine::Init(int argc, char *argv[])
 {
@@ -27,22 +27,87 @@
 #include "gametype.h"
 #include "globaldata.h"
 #include "globallanguage.h"
+#include "iniparseindex.h"
 #include "mouse.h"
+#include "numberscan.h"
 #include "playertemplate.h"
+#include "ramfile.h"
 #include "rankinfo.h"
+#include "rtsutils.h"
 #include "science.h"
+#include "stringsimd.h"
 #include "terrainroads.h"
 #include "terraintypes.h"
 #include "water.h"
 #include "xfer.h"
 #include <algorithm>
 #include <cctype>
-#include <cstdio>
+
+#ifndef GAME_DLL
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
 
 using GameMath::Ceil;
 
 #ifndef GAME_DLL
 Xfer *g_sXfer = nullptr;
+
+namespace
+{
+INICache *s_compiledCache = nullptr;
+const char s_compiledCacheName[] = "CompiledINI.cache";
+bool s_parallelLoad = false;
+
+/**
+ * @brief Cleans the next line of a text file where it is, returns its length and moves pos past it.
+ */
+int Clean_Next_Line(char *data, int size, int &pos, bool &end_of_file)
+{
+    // Lines are split every MAX_LINE_LENGTH characters just like the original's fixed size buffer splits them.
+    char *line = data + pos;
+    int limit = std::min(size - pos, int(INI::MAX_LINE_LENGTH));
+    int length = rts::Clean_Line(line, limit, ';');
+    char *end = length < limit && line[length] == '\n'
+        ? line + length
+        : static_cast<char *>(memchr(line + length, '\n', limit - length));
+
+    if (end != nullptr) {
+        pos += int(end - line) + 1;
+    } else {
+        pos += limit;
+        end_of_file = limit < INI::MAX_LINE_LENGTH;
+    }
+
+    return length;
+}
+
+void Append_Compiled_Line(std::vector<char> &lines, const char *line, int length)
+{
+    uint16_t compiled_length = uint16_t(length);
+    const char *bytes = reinterpret_cast<const char *>(&compiled_length);
+    lines.insert(lines.end(), bytes, bytes + sizeof(compiled_length));
+    lines.insert(lines.end(), line, line + length);
+    lines.push_back('\0');
+}
+
+/**
+ * @brief Turns a whole text file into the compiled lines reading it line by line would have recorded.
+ */
+void Compile_Lines(char *data, int size, std::vector<char> &lines)
+{
+    int pos = 0;
+    bool end_of_file = false;
+
+    while (!end_of_file) {
+        const char *line = data + pos;
+        int length = Clean_Next_Line(data, size, pos, end_of_file);
+        Append_Compiled_Line(lines, line, length);
+    }
+}
+} // namespace
 #endif
 
 const float _SECONDS_PER_LOGICFRAME_REAL_74 = 1.0f / 30.0f;
@@ -129,6 +194,7 @@ BlockParse TheTypeTable[] = {
 // Helper function for Load
 inline iniblockparse_t Find_Block_Parse(const char *token)
 {
+#ifdef GAME_DLL
     // Iterate over the TypeTable to identify correct parsing function.
     for (BlockParse *block = TheTypeTable; block->token != nullptr; ++block) {
         if (strcmp(block->token, token) == 0) {
@@ -137,9 +203,17 @@ inline iniblockparse_t Find_Block_Parse(const char *token)
     }
 
     return nullptr;
+#else
+    // The TypeTable never changes so its index is only looked up once.
+    static INIParseIndex const &index = INIParseIndex::Get(TheTypeTable);
+
+    // Look the token up in the TypeTable to identify correct parsing function, the terminating entry has no function.
+    return TheTypeTable[index.Find(token)].parse_func;
+#endif
 }
 
 // Helper function for Init_From_INI_Multi
+#ifdef GAME_DLL
 inline inifieldparse_t Find_Field_Parse(FieldParse *table, const char *token, int &offset, const void *&data)
 {
     FieldParse *tblptr;
@@ -154,6 +228,21 @@ inline inifieldparse_t Find_Field_Parse(FieldParse *table, const char *token, in
             return tblptr->parse_func;
         }
     }
+#else
+inline inifieldparse_t Find_Field_Parse(
+    FieldParse *table, INIParseIndex const &index, const char *token, int &offset, const void *&data)
+{
+    // Search the list for a matching FieldParse struct.
+    FieldParse *tblptr = &table[index.Find(token)];
+
+    // If found, return the data and associated function.
+    if (tblptr->token != nullptr) {
+        offset = tblptr->offset;
+        data = tblptr->user_data;
+
+        return tblptr->parse_func;
+    }
+#endif
 
     // Didn't find matching token, but null token entry has a function
     if (tblptr->parse_func != nullptr) {
@@ -169,8 +258,19 @@ inline inifieldparse_t Find_Field_Parse(FieldParse *table, const char *token, in
 
 INI::INI() :
     m_backingFile(nullptr),
+#ifdef GAME_DLL
     m_bufferReadPos(0),
     m_bufferData(0),
+#else
+    m_fileData(nullptr),
+    m_fileSize(0),
+    m_fileCapacity(0),
+    m_filePos(0),
+    m_currentLine(m_currentBlock),
+    m_tokenPos(nullptr),
+    m_compiled(false),
+    m_recordLines(false),
+#endif
     m_fileName("None"),
     m_loadType(INI_LOAD_INVALID),
     m_lineNumber(0),
@@ -184,7 +284,12 @@ INI::INI() :
     m_currentBlock[0] = '\0';
 }
 
-INI::~INI() {}
+INI::~INI()
+{
+#ifndef GAME_DLL
+    delete[] m_fileData;
+#endif
+}
 
 void INI::Load(Utf8String filename, INILoadType type, Xfer *xfer)
 {
@@ -199,7 +304,7 @@ void INI::Load(Utf8String filename, INILoadType type, Xfer *xfer)
         // parsed block, possible leftover from debug code?
         // Utf8String block(m_currentBlock);
 
-        char *token = strtok(m_currentBlock, m_seps);
+        char *token = Tokenize(Get_Current_Line(), m_seps);
 
         if (token != nullptr) {
             iniblockparse_t parser = Find_Block_Parse(token);
@@ -226,6 +331,8 @@ void INI::Load_Directory(Utf8String dir, bool search_subdirs, INILoadType type,
     dir += '/';
 
     g_theFileSystem->Get_File_List_From_Dir(dir, "*.ini", files, true);
+    std::vector<Utf8String> ordered;
+    ordered.reserve(files.size());
 
     // Load everything from the top level directory first.
     for (auto it = files.begin(); it != files.end(); ++it) {
@@ -233,7 +340,7 @@ void INI::Load_Directory(Utf8String dir, bool search_subdirs, INILoadType type,
         Utf8String path_check = &it->Str()[strlen(dir.Str())];
 
         if (strchr(path_check.Str(), '\\') == nullptr && strchr(path_check.Str(), '/') == nullptr) {
-            Load(*it, type, xfer);
+            ordered.push_back(*it);
         }
     }
 
@@ -243,18 +350,79 @@ void INI::Load_Directory(Utf8String dir, bool search_subdirs, INILoadType type,
         Utf8String path_check = &it->Str()[dir.Get_Length()];
 
         if (strchr(path_check.Str(), '\\') != nullptr || strchr(path_check.Str(), '/') != nullptr) {
+            ordered.push_back(*it);
+        }
+    }
+
+#ifndef GAME_DLL
+    if (s_parallelLoad && ordered.size() > 1) {
+        Load_Files_Parallel(ordered, type, xfer);
+    } else {
+        for (auto it = ordered.begin(); it != ordered.end(); ++it) {
             Load(*it, type, xfer);
         }
     }
+#else
+    for (auto it = ordered.begin(); it != ordered.end(); ++it) {
+        Load(*it, type, xfer);
+    }
+#endif
+
+#ifndef GAME_DLL
+    captainslog_debug("Loaded INI files from '%s', parse table indices have saved %llu string compares so far.",
+        dir.Str(),
+        (unsigned long long)INIParseIndex::Get_Compares_Saved());
+
+    // Only written when something had to be parsed so launches where nothing changed don't touch the disk.
+    if (s_compiledCache != nullptr && s_compiledCache->Is_Dirty()) {
+        s_compiledCache->Save(s_compiledCacheName);
+    }
+#endif
 }
 
 void INI::Prep_File(Utf8String filename, INILoadType type)
 {
     captainslog_relassert(m_backingFile == nullptr, 0xDEAD0006, "Cannot open file %s, file already open.", filename.Str());
 
+#ifdef GAME_DLL
     m_backingFile = g_theFileSystem->Open(filename.Str(), File::READ);
 
     captainslog_relassert(m_backingFile != nullptr, 0xDEAD0006, "Could not open file %s.", filename.Str());
+#else
+    const char *lines;
+    int size;
+    m_recordLines = s_compiledCache != nullptr && s_compiledCache->Get_Stamp(filename.Str(), m_stamp);
+    m_compiledLines.clear();
+
+    if (!m_stagedLines.empty()) {
+        // Staged lines were compiled from the file on a worker thread, they are kept to go in the compiled cache too.
+        m_compiled = true;
+        m_compiledLines.swap(m_stagedLines);
+        lines = m_compiledLines.data();
+        size = int(m_compiledLines.size());
+    } else {
+        m_compiled = m_recordLines && s_compiledCache->Find(filename, m_stamp, lines, size);
+        m_recordLines = m_recordLines && !m_compiled;
+    }
+
+    if (m_compiled) {
+        // Compiled files aren't opened at all, the lines are copied as tokenizing writes into them.
+        Reserve_File_Data(size);
+        memcpy(m_fileData, lines, size);
+        m_fileSize = size;
+    } else {
+        m_backingFile = g_theFileSystem->Open(filename.Str(), File::READ);
+
+        captainslog_relassert(m_backingFile != nullptr, 0xDEAD0006, "Could not open file %s.", filename.Str());
+
+        // The whole file is read up front so lines can be scanned and tokenized where they are.
+        size = std::max(m_backingFile->Size(), 0);
+        Reserve_File_Data(size);
+        m_fileSize = std::max(m_backingFile->Read(m_fileData, size), 0);
+    }
+
+    m_filePos = 0;
+#endif
 
     m_fileName = filename;
     m_loadType = type;
@@ -262,10 +430,31 @@ void INI::Prep_File(Utf8String filename, INILoadType type)
 
 void INI::Unprep_File()
 {
+#ifdef GAME_DLL
     m_backingFile->Close();
+#else
+    if (m_backingFile != nullptr) {
+        m_backingFile->Close();
+    }
+
+    // Only files that were parsed to the end are worth replaying.
+    if (m_recordLines && m_endOfFile) {
+        s_compiledCache->Add_File(m_fileName, m_stamp, m_compiledLines);
+    }
+
+    m_compiled = false;
+    m_recordLines = false;
+#endif
     m_backingFile = nullptr;
+#ifdef GAME_DLL
     m_bufferReadPos = 0;
     m_bufferData = 0;
+#else
+    m_fileSize = 0;
+    m_filePos = 0;
+    m_currentLine = m_currentBlock;
+    m_tokenPos = nullptr;
+#endif
     m_fileName = "None";
     m_loadType = INI_LOAD_INVALID;
     m_lineNumber = 0;
@@ -273,6 +462,133 @@ void INI::Unprep_File()
     g_sXfer = nullptr;
 }
 
+#ifndef GAME_DLL
+/**
+ * @brief Makes sure the file buffer can hold size bytes and a terminator.
+ */
+void INI::Reserve_File_Data(int size)
+{
+    if (size >= m_fileCapacity) {
+        delete[] m_fileData;
+        m_fileCapacity = size + 1;
+        m_fileData = new char[m_fileCapacity];
+    }
+}
+
+/**
+ * @brief Loads files in order while worker threads read and compile the files after them.
+ */
+void INI::Load_Files_Parallel(std::vector<Utf8String> const &files, INILoadType type, Xfer *xfer)
+{
+    // Block parsers fill in global stores so only reading and cleaning the text can happen on other threads, files
+    // are still parsed one at a time in the same order as always so overrides and the CRC are unaffected.
+    struct StagedFile
+    {
+        std::vector<char> lines; // Left empty when the file has to be loaded the usual way.
+        bool done;
+    };
+
+    std::vector<StagedFile> staged(files.size());
+    std::vector<PrefetchHandle> handles(files.size());
+    std::mutex mutex;
+    std::condition_variable compiled;
+    std::atomic<int> next_file(0);
+#if LOGGING_LEVEL >= LOGLEVEL_INFO
+    unsigned start_time = rts::Get_Time();
+#endif
+
+    // Files already in the compiled cache don't need reading, the rest are queued on the I/O thread in load order.
+    for (size_t i = 0; i < files.size(); ++i) {
+        INICache::Stamp stamp;
+        const char *lines;
+        int size;
+        staged[i].done = false;
+
+        if (s_compiledCache == nullptr || !s_compiledCache->Get_Stamp(files[i].Str(), stamp)
+            || !s_compiledCache->Find(files[i], stamp, lines, size)) {
+            handles[i] = g_theFileSystem->Prefetch(files[i].Str());
+        }
+    }
+
+    auto worker = [&]() {
+        for (int i = next_file++; i < int(files.size()); i = next_file++) {
+            std::vector<char> lines;
+            File *file = handles[i].Wait() ? g_theFileSystem->Open_Prefetched(files[i].Str()) : nullptr;
+
+            if (file != nullptr) {
+                int size = std::max(file->Size(), 0);
+                std::vector<char> data(size + 1);
+                size = std::max(file->Read(data.data(), size), 0);
+                file->Close();
+                Compile_Lines(data.data(), size, lines);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                staged[i].lines.swap(lines);
+                staged[i].done = true;
+            }
+
+            compiled.notify_all();
+        }
+    };
+
+    // Prefetched files are opened on the workers, the pool they come from is created lazily without locking.
+    RAMFile::Create_Class_Pool();
+
+    // The calling thread is busy parsing so there is always at least one worker.
+    int threads = std::max(
+        std::min({ int(std::thread::hardware_concurrency()) - 1, int(files.size()), int(LOAD_THREADS_MAX) }), 1);
+    std::vector<std::thread> pool;
+
+    for (int i = 0; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            compiled.wait(lock, [&]() { return staged[i].done; });
+            m_stagedLines.swap(staged[i].lines);
+        }
+
+        Load(files[i], type, xfer);
+        m_stagedLines.clear();
+    }
+
+    for (std::thread &thread : pool) {
+        thread.join();
+    }
+
+#if LOGGING_LEVEL >= LOGLEVEL_INFO
+    captainslog_info(
+        "Loaded %d INI files in %u ms with %d worker threads.", int(files.size()), rts::Get_Time() - start_time, threads);
+#endif
+}
+
+/**
+ * @brief Turns loading the files of a directory on worker threads on or off.
+ */
+void INI::Enable_Parallel_Load(bool enable)
+{
+    s_parallelLoad = enable;
+}
+
+/**
+ * @brief Turns the compiled INI cache on or off, files found in it are replayed instead of being read and cleaned.
+ */
+void INI::Enable_Compiled_Cache(bool enable)
+{
+    if (enable && s_compiledCache == nullptr) {
+        s_compiledCache = new INICache;
+        s_compiledCache->Load(s_compiledCacheName);
+    } else if (!enable && s_compiledCache != nullptr) {
+        delete s_compiledCache;
+        s_compiledCache = nullptr;
+    }
+}
+#endif
+
 void INI::Init_From_INI(void *what, FieldParse *parse_table)
 {
     MultiIniFieldParse p;
@@ -287,17 +603,26 @@ void INI::Init_From_INI_Multi(void *what, const MultiIniFieldParse &parse_table_
 
     captainslog_relassert(what != nullptr, 0xDEAD0006, "Init_From_INI - Invalid parameters supplied.");
 
+#ifndef GAME_DLL
+    // Fetch the indices up front so fields don't each have to find them.
+    INIParseIndex const *indices[MultiIniFieldParse::MAX_MULTI_FIELDS];
+
+    for (int i = 0; i < parse_table_list.count; ++i) {
+        indices[i] = &INIParseIndex::Get(parse_table_list.field_parsers[i]);
+    }
+
+#endif
     while (!done) {
         captainslog_relassert(!m_endOfFile,
             0xDEAD0006,
             "Error parsing block '%s', in INI file '%s'.  Missing '%s' token",
-            m_currentBlock,
+            Get_Current_Line(),
             m_fileName.Str(),
             m_endToken);
 
         Read_Line();
 
-        char *token = strtok(m_currentBlock, m_seps);
+        char *token = Tokenize(Get_Current_Line(), m_seps);
 
         if (token == nullptr) {
             continue;
@@ -319,9 +644,13 @@ void INI::Init_From_INI_Multi(void *what, const MultiIniFieldParse &parse_table_
                     m_lineNumber,
                     m_fileName.Str(),
                     token,
-                    m_currentBlock);
+                    Get_Current_Line());
 
+#ifdef GAME_DLL
                 parsefunc = Find_Field_Parse(parse_table_list.field_parsers[i], token, offset, data);
+#else
+                parsefunc = Find_Field_Parse(parse_table_list.field_parsers[i], *indices[i], token, offset, data);
+#endif
 
                 if (parsefunc != nullptr) {
                     exoffset = parse_table_list.extra_offsets[i];
@@ -345,6 +674,7 @@ void INI::Init_From_INI_Multi_Proc(void *what, void (*proc)(MultiIniFieldParse *
 
 void INI::Read_Line()
 {
+#ifdef GAME_DLL
     captainslog_dbgassert(m_backingFile != nullptr, "Read_Line file pointer is nullptr.");
 
     if (m_endOfFile) {
@@ -389,6 +719,48 @@ void INI::Read_Line()
     if (g_sXfer != nullptr) {
         g_sXfer->xferImplementation(m_currentBlock, strlen(m_currentBlock));
     }
+#else
+    captainslog_dbgassert(m_fileData != nullptr, "Read_Line file data is nullptr.");
+    int length = 0;
+
+    if (m_endOfFile) {
+        m_currentLine = m_currentBlock;
+        m_currentBlock[0] = '\0';
+    } else if (m_compiled) {
+        // Compiled lines are already clean, each is its length followed by the terminated text.
+        uint16_t compiled_length;
+        memcpy(&compiled_length, m_fileData + m_filePos, sizeof(compiled_length));
+        length = compiled_length;
+        m_currentLine = m_fileData + m_filePos + sizeof(compiled_length);
+        m_filePos += sizeof(compiled_length) + length + 1;
+        m_endOfFile = m_filePos >= m_fileSize;
+        ++m_lineNumber;
+    } else {
+        char *line = m_fileData + m_filePos;
+        length = Clean_Next_Line(m_fileData, m_fileSize, m_filePos, m_endOfFile);
+
+        // The buffer has room for a terminator after the last line, a full length line needs its own.
+        if (length < MAX_LINE_LENGTH) {
+            line[length] = '\0';
+        } else {
+            memcpy(m_currentBlock, line, MAX_LINE_LENGTH);
+            m_blockEnd = '\0';
+            line = m_currentBlock;
+        }
+
+        m_currentLine = line;
+        ++m_lineNumber;
+
+        if (m_recordLines) {
+            Append_Compiled_Line(m_compiledLines, line, length);
+        }
+    }
+
+    // If we have a transfer object assigned, do the transfer.
+    if (g_sXfer != nullptr) {
+        g_sXfer->xferImplementation(m_currentLine, length);
+    }
+#endif
 }
 
 Utf8String INI::Get_Next_Quoted_Ascii_String()
@@ -439,8 +811,8 @@ int INI::Scan_Science(const char *token)
 float INI::Scan_PercentToReal(const char *token)
 {
     float value;
-    int res = sscanf(token, "%f", &value);
-    captainslog_relassert(res == 1, 0xDEAD0006, "Unable to parse percentage from token %s.", token);
+    const char *end = rts::Scan_Float(token, value);
+    captainslog_relassert(end != nullptr, 0xDEAD0006, "Unable to parse percentage from token %s.", token);
 
     return (float)(value / 100.0f);
 }
@@ -448,26 +820,26 @@ float INI::Scan_PercentToReal(const char *token)
 float INI::Scan_Real(const char *token)
 {
     float value;
-    int res = sscanf(token, "%f", &value);
-    captainslog_relassert(res == 1, 0xDEAD0006, "Unable to parse float from token %s.", token);
+    const char *end = rts::Scan_Float(token, value);
+    captainslog_relassert(end != nullptr, 0xDEAD0006, "Unable to parse float from token %s.", token);
 
     return (float)value;
 }
 
 unsigned int INI::Scan_UnsignedInt(const char *token)
 {
-    unsigned int value;
-    int res = sscanf(token, "%u", &value);
-    captainslog_relassert(res == 1, 0xDEAD0006, "Unable to parse unsigned int from token %s.", token);
+    uint32_t value;
+    const char *end = rts::Scan_UInt32(token, value);
+    captainslog_relassert(end != nullptr, 0xDEAD0006, "Unable to parse unsigned int from token %s.", token);
 
     return value;
 }
 
 int INI::Scan_Int(const char *token)
 {
-    int value;
-    int res = sscanf(token, "%d", &value);
-    captainslog_relassert(res == 1, 0xDEAD0006, "Unable to parse int from token %s.", token);
+    int32_t value;
+    const char *end = rts::Scan_Int32(token, value);
+    captainslog_relassert(end != nullptr, 0xDEAD0006, "Unable to parse int from token %s.", token);
 
     return value;
 }
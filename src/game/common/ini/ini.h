@@ -18,6 +18,11 @@
 #include "asciistring.h"
 #include <captainslog.h>
 
+#ifndef GAME_DLL
+#include "inicache.h"
+#include <vector>
+#endif
+
 class File;
 class Xfer;
 class INI;
@@ -88,6 +93,9 @@ public:
     {
         MAX_LINE_LENGTH = 1028,
         MAX_BUFFER_SIZE = 8192,
+#ifndef GAME_DLL
+        LOAD_THREADS_MAX = 4, // Cleaning lines is quick next to parsing them so a few workers keep up.
+#endif
     };
 
     INI();
@@ -109,6 +117,11 @@ public:
     INILoadType Get_Load_Type() { return m_loadType; }
     int Get_Line_Number() { return m_lineNumber; }
 
+#ifndef GAME_DLL
+    static void Enable_Compiled_Cache(bool enable);
+    static void Enable_Parallel_Load(bool enable);
+#endif
+
     // Scan functions
     static int Scan_Science(const char *token);
     static float Scan_PercentToReal(const char *token);
@@ -160,11 +173,31 @@ private:
     void Read_Line();
     void Prep_File(Utf8String filename, INILoadType type);
     void Unprep_File();
+    char *Tokenize(char *str, const char *seps);
+    char *Get_Current_Line();
+#ifndef GAME_DLL
+    void Reserve_File_Data(int size);
+    void Load_Files_Parallel(std::vector<Utf8String> const &files, INILoadType type, Xfer *xfer);
+#endif
 
     File *m_backingFile;
+#ifdef GAME_DLL
     char m_buffer[MAX_BUFFER_SIZE];
     int m_bufferReadPos;
     int m_bufferData;
+#else
+    char *m_fileData; // Whole file with room for a terminator, lines are cleaned and tokenized in place.
+    int m_fileSize;
+    int m_fileCapacity;
+    int m_filePos;
+    char *m_currentLine; // Points into m_fileData or at m_currentBlock for lines that had to be copied.
+    char *m_tokenPos; // Where the next token is searched for, replaces the global state strtok keeps.
+    bool m_compiled; // m_fileData holds lines from the compiled cache rather than text.
+    bool m_recordLines; // Lines are kept in m_compiledLines to be added to the compiled cache.
+    INICache::Stamp m_stamp;
+    std::vector<char> m_compiledLines;
+    std::vector<char> m_stagedLines; // Compiled ahead of time by Load_Files_Parallel for the next file to load.
+#endif
     Utf8String m_fileName;
     INILoadType m_loadType;
     int m_lineNumber;
@@ -186,14 +219,55 @@ extern Xfer *g_sXfer;
 #endif
 
 // Functions for inlining, neater than including in class declaration
+inline char *INI::Tokenize(char *str, const char *seps)
+{
+#ifdef GAME_DLL
+    return strtok(str, seps);
+#else
+    // Behaves exactly like strtok but keeps its position in the INI so several can be parsed at once.
+    char *token = str != nullptr ? str : m_tokenPos;
+
+    if (token == nullptr) {
+        return nullptr;
+    }
+
+    token += strspn(token, seps);
+
+    if (*token == '\0') {
+        m_tokenPos = token;
+
+        return nullptr;
+    }
+
+    char *end = token + strcspn(token, seps);
+
+    if (*end != '\0') {
+        *end++ = '\0';
+    }
+
+    m_tokenPos = end;
+
+    return token;
+#endif
+}
+
+inline char *INI::Get_Current_Line()
+{
+#ifdef GAME_DLL
+    return m_currentBlock;
+#else
+    return m_currentLine;
+#endif
+}
+
 inline const char *INI::Get_Next_Token_Or_Null(const char *seps)
 {
-    return strtok(0, seps != nullptr ? seps : m_seps);
+    return Tokenize(nullptr, seps != nullptr ? seps : m_seps);
 }
 
 inline const char *INI::Get_Next_Token(const char *seps)
 {
-    char *ret = strtok(0, seps != nullptr ? seps : m_seps);
+    char *ret = Tokenize(nullptr, seps != nullptr ? seps : m_seps);
     captainslog_relassert(
         ret != nullptr, 0xDEAD0006, "Expected further tokens in '%s', line %d", m_fileName.Str(), m_lineNumber);
 
@@ -0,0 +1,266 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief On disk cache of compiled INI files so later launches don't have to read and clean the text again.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "inicache.h"
+
+#ifndef GAME_DLL
+#include "archivefilesystem.h"
+#include "cachefile.h"
+#include "ini.h"
+#include "localfilesystem.h"
+#include <captainslog.h>
+#include <cstring>
+
+using rts::Cache_Put_Data;
+using rts::Cache_Put_Int;
+using rts::Cache_Put_Padding;
+using rts::Cache_Put_String;
+using rts::CacheReader;
+using rts::FourCC;
+using std::memchr;
+using std::memcmp;
+using std::memcpy;
+
+namespace
+{
+/**
+ * @brief Checks every line of a compiled file is whole and no longer than the parser allows.
+ */
+bool Lines_Valid(const char *lines, uint32_t size)
+{
+    uint32_t pos = 0;
+
+    while (pos < size) {
+        uint16_t length;
+
+        if (size - pos < sizeof(length)) {
+            return false;
+        }
+
+        memcpy(&length, lines + pos, sizeof(length));
+        pos += sizeof(length);
+
+        if (length > INI::MAX_LINE_LENGTH || size - pos < uint32_t(length) + 1 || lines[pos + length] != '\0'
+            || memchr(lines + pos, '\0', length) != nullptr) {
+            return false;
+        }
+
+        pos += length + 1;
+    }
+
+    return size > 0;
+}
+} // namespace
+
+/**
+ * @brief Reads a cache file, returns false and leaves the cache empty if it is missing or not valid.
+ */
+bool INICache::Load(const char *filename)
+{
+    Clear();
+
+    File *file = g_theLocalFileSystem->Open_File(filename, File::READ | File::BINARY);
+
+    if (file == nullptr) {
+        return false;
+    }
+
+    int size = file->Size();
+
+    if (size <= 0) {
+        file->Close();
+        return false;
+    }
+
+    m_buffer = new uint8_t[size];
+    int read = file->Read(m_buffer, size);
+    file->Close();
+
+    CacheReader reader(m_buffer, read > 0 ? uint32_t(read) : 0);
+    uint32_t fourcc;
+    uint32_t version;
+    uint32_t file_count;
+    uint32_t total_size;
+
+    // The total size catches a cache that was only partly written.
+    if (!reader.Get_Int(fourcc) || !reader.Get_Int(version) || !reader.Get_Int(file_count) || !reader.Get_Int(total_size)
+        || fourcc != FourCC<'T', 'I', 'N', 'I'>::value || version != CACHE_VERSION || total_size != uint32_t(size)
+        || read != size) {
+        captainslog_info("Compiled INI cache '%s' is out of date, INI files will be parsed again.", filename);
+        Clear();
+
+        return false;
+    }
+
+    for (uint32_t i = 0; i < file_count; ++i) {
+        uint32_t path_size;
+        uint32_t lines_size;
+        const uint8_t *path;
+        const uint8_t *stamp;
+        const uint8_t *lines;
+
+        if (!reader.Get_Int(path_size) || (path = reader.Get(path_size)) == nullptr
+            || (stamp = reader.Get(sizeof(Stamp))) == nullptr || !reader.Get_Int(lines_size)
+            || (lines = reader.Get(rts::Cache_Pad_Size(lines_size))) == nullptr || path_size == 0
+            || path[path_size - 1] != '\0' || !Lines_Valid(reinterpret_cast<const char *>(lines), lines_size)) {
+            captainslog_error("Compiled INI cache '%s' is corrupt, INI files will be parsed again.", filename);
+            Clear();
+
+            return false;
+        }
+
+        CachedFile &cached = m_files[reinterpret_cast<const char *>(path)];
+        memcpy(&cached.stamp, stamp, sizeof(cached.stamp));
+        cached.lines = reinterpret_cast<const char *>(lines);
+        cached.size = int(lines_size);
+        cached.used = false;
+    }
+
+    captainslog_info("Loaded compiled INI cache '%s' holding %u files.", filename, file_count);
+
+    return true;
+}
+
+/**
+ * @brief Writes out the files used this session along with any others that haven't changed since they were cached.
+ */
+bool INICache::Save(const char *filename)
+{
+    std::vector<uint8_t> buffer;
+    uint32_t file_count = 0;
+
+    Cache_Put_Int(buffer, FourCC<'T', 'I', 'N', 'I'>::value);
+    Cache_Put_Int(buffer, CACHE_VERSION);
+    Cache_Put_Int(buffer, 0);
+    Cache_Put_Int(buffer, 0);
+
+    for (auto it = m_files.begin(); it != m_files.end(); ++it) {
+        CachedFile const &cached = it->second;
+        Stamp stamp;
+
+        // Files from other sessions, such as those of maps not played this time, are kept while they still match.
+        if (!cached.used && (!Get_Stamp(it->first.Str(), stamp) || memcmp(&stamp, &cached.stamp, sizeof(stamp)) != 0)) {
+            continue;
+        }
+
+        Cache_Put_String(buffer, it->first.Str(), uint32_t(it->first.Get_Length()));
+        Cache_Put_Data(buffer, &cached.stamp, sizeof(cached.stamp));
+        Cache_Put_Int(buffer, uint32_t(cached.size));
+        Cache_Put_Data(buffer, cached.lines, cached.size);
+        Cache_Put_Padding(buffer);
+        ++file_count;
+    }
+
+    uint32_t total_size = uint32_t(buffer.size());
+    memcpy(&buffer[8], &file_count, sizeof(file_count));
+    memcpy(&buffer[12], &total_size, sizeof(total_size));
+
+    File *file = g_theLocalFileSystem->Open_File(filename, File::WRITE | File::CREATE | File::TRUNCATE | File::BINARY);
+
+    if (file == nullptr) {
+        captainslog_warn("Couldn't write compiled INI cache '%s'.", filename);
+        return false;
+    }
+
+    bool written = file->Write(buffer.data(), int(buffer.size())) == int(buffer.size());
+    file->Close();
+    m_dirty = !written;
+
+    return written;
+}
+
+void INICache::Clear()
+{
+    m_files.clear();
+    m_archiveInfo.clear();
+    delete[] m_buffer;
+    m_buffer = nullptr;
+    m_dirty = false;
+}
+
+/**
+ * @brief Works out where a file would be opened from the same way FileSystem::Open does, fails if it doesn't exist.
+ */
+bool INICache::Get_Stamp(const char *filename, Stamp &stamp)
+{
+    if (g_theLocalFileSystem->Get_File_Info(filename, &stamp.info)) {
+        stamp.position = -1;
+        stamp.size = 0;
+
+        return true;
+    }
+
+    Utf8String archive;
+    int position;
+    int size;
+
+    if (g_theArchiveFileSystem == nullptr
+        || !g_theArchiveFileSystem->Get_Archived_File_Location(filename, archive, position, size)) {
+        return false;
+    }
+
+    FastCriticalSectionClass::LockClass lock(m_lock);
+    auto it = m_archiveInfo.find(archive);
+
+    if (it == m_archiveInfo.end()) {
+        FileInfo info;
+
+        if (!g_theLocalFileSystem->Get_File_Info(archive, &info)) {
+            return false;
+        }
+
+        it = m_archiveInfo.insert(std::make_pair(archive, info)).first;
+    }
+
+    stamp.info = it->second;
+    stamp.position = position;
+    stamp.size = size;
+
+    return true;
+}
+
+/**
+ * @brief Gets the compiled lines of a file, fails if it isn't cached or the file changed since.
+ */
+bool INICache::Find(Utf8String const &filename, Stamp const &stamp, const char *&lines, int &size)
+{
+    FastCriticalSectionClass::LockClass lock(m_lock);
+    auto it = m_files.find(filename);
+
+    if (it == m_files.end() || memcmp(&it->second.stamp, &stamp, sizeof(stamp)) != 0) {
+        return false;
+    }
+
+    it->second.used = true;
+    lines = it->second.lines;
+    size = it->second.size;
+
+    return true;
+}
+
+/**
+ * @brief Stores the compiled lines of a file that had to be parsed, the vector is taken over by the cache.
+ */
+void INICache::Add_File(Utf8String const &filename, Stamp const &stamp, std::vector<char> &lines)
+{
+    FastCriticalSectionClass::LockClass lock(m_lock);
+    CachedFile &cached = m_files[filename];
+    cached.stamp = stamp;
+    cached.owned_lines.swap(lines);
+    cached.lines = cached.owned_lines.data();
+    cached.size = int(cached.owned_lines.size());
+    cached.used = true;
+    m_dirty = true;
+}
+#endif
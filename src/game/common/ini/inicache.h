@@ -0,0 +1,84 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief On disk cache of compiled INI files so later launches don't have to read and clean the text again.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "asciistring.h"
+
+// Relies on the archive file index which the original binary has no equivalent of.
+#ifndef GAME_DLL
+#include "critsection.h"
+#include "file.h"
+#include "rtsutils.h"
+#include <map>
+#include <vector>
+
+/**
+ * Holds each INI file as the lines the parser sees, with comments and control characters already dealt with, keyed by
+ * the file's path and a stamp of where it was loaded from. A compiled file is the lines one after the other, each a
+ * 16 bit length followed by the nul terminated text, which is exactly what gets tokenized and CRC'd so replaying them
+ * gives the same results as parsing the text. A file that changed or now comes from somewhere else is simply parsed
+ * again and replaces its old entry the next time the cache is saved. Finding and adding files is safe from several
+ * threads at once.
+ *
+ * Only the reading and cleaning is skipped, every block is still parsed. Most block types, objects and weapons among
+ * them, have no Thyme parser yet. The stores that do, such as audio events, terrain, roads and water, are filled in
+ * through field parse tables. Those tables resolve names against other stores and the name key generator, and later
+ * files and override load types change what earlier files made. Caching their results would need a serialiser per
+ * store that reproduces all of that. The multiplayer CRC is also taken over the lines as they are parsed.
+ */
+class INICache
+{
+    enum
+    {
+        CACHE_VERSION = 1,
+    };
+
+public:
+    struct Stamp
+    {
+        FileInfo info; // Of the file itself or of the archive holding it.
+        int32_t position; // Negative for files loaded from disk rather than an archive.
+        int32_t size;
+    };
+
+    INICache() : m_buffer(nullptr), m_dirty(false) {}
+    ~INICache() { Clear(); }
+
+    bool Load(const char *filename);
+    bool Save(const char *filename);
+    void Clear();
+    bool Get_Stamp(const char *filename, Stamp &stamp);
+    bool Find(Utf8String const &filename, Stamp const &stamp, const char *&lines, int &size);
+    void Add_File(Utf8String const &filename, Stamp const &stamp, std::vector<char> &lines);
+    bool Is_Dirty() const { return m_dirty; }
+
+private:
+    struct CachedFile
+    {
+        Stamp stamp;
+        const char *lines;
+        int size;
+        bool used;
+        std::vector<char> owned_lines; // Only filled for files parsed this session.
+    };
+
+    uint8_t *m_buffer;
+    std::map<Utf8String, CachedFile, rts::less_than_nocase<Utf8String>> m_files;
+    std::map<Utf8String, FileInfo> m_archiveInfo; // Archives already stamped this session.
+    bool m_dirty;
+    FastCriticalSectionClass m_lock;
+};
+#endif
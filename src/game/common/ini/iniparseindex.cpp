@@ -0,0 +1,201 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Hash lookup of tokens in INI parse tables.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "iniparseindex.h"
+
+#ifndef GAME_DLL
+#include "critsection.h"
+#include "ini.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <memory>
+
+using std::strcmp;
+
+namespace
+{
+enum
+{
+    REGISTRY_SIZE = 4096, // Power of two, the game has a few hundred parse tables.
+    REGISTRY_MAX = REGISTRY_SIZE / 2, // Tables past this are only found under the lock.
+};
+
+/**
+ * @brief A table whose index has been built, the index is stored before the table so finding one means both are set.
+ */
+struct RegistrySlot
+{
+    std::atomic<const void *> table;
+    std::atomic<INIParseIndex *> index;
+};
+
+// Open addressing on the table pointer, slots are only ever filled under the lock and never emptied.
+RegistrySlot s_registry[REGISTRY_SIZE];
+int s_registryCount;
+
+FastCriticalSectionClass s_indexLock;
+std::map<const void *, std::unique_ptr<INIParseIndex>> s_indices;
+
+// String compares a linear search of the tables would have made on top of those the indices did.
+std::atomic<uint64_t> s_comparesSaved(0);
+} // namespace
+
+/**
+ * @brief Gets the index of a field parse table, building it if this is the first time the table is searched.
+ */
+INIParseIndex const &INIParseIndex::Get(FieldParse const *table)
+{
+    return Get_Index(table);
+}
+
+/**
+ * @brief Gets the index of a block parse table, building it if this is the first time the table is searched.
+ */
+INIParseIndex const &INIParseIndex::Get(BlockParse const *table)
+{
+    return Get_Index(table);
+}
+
+uint64_t INIParseIndex::Get_Compares_Saved()
+{
+    return s_comparesSaved.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Finds the first entry of the table with a token, returns the index of the terminating entry if there is none.
+ */
+int INIParseIndex::Find(const char *token) const
+{
+    uint32_t hash = Hash_Token(token);
+    size_t mask = m_slots.size() - 1;
+    int compares = 0;
+
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        Slot const &slot = m_slots[i];
+
+        // Probing can compare more tokens than a linear search would have, that counts as nothing saved.
+        if (slot.index < 0) {
+            s_comparesSaved.fetch_add(uint64_t(std::max(Get_Size() - compares, 0)), std::memory_order_relaxed);
+            return Get_Size();
+        }
+
+        if (slot.hash == hash) {
+            ++compares;
+
+            if (strcmp(m_tokens[slot.index], token) == 0) {
+                s_comparesSaved.fetch_add(uint64_t(std::max(slot.index + 1 - compares, 0)), std::memory_order_relaxed);
+                return slot.index;
+            }
+        }
+    }
+}
+
+template<typename T> INIParseIndex const &INIParseIndex::Get_Index(T const *table)
+{
+    uint32_t mask = REGISTRY_SIZE - 1;
+    uint32_t start = Hash_Table(table) & mask;
+
+    // The registry is never more than half full so there is always an empty slot to end the search.
+    for (uint32_t i = start;; i = (i + 1) & mask) {
+        const void *found = s_registry[i].table.load(std::memory_order_acquire);
+
+        if (found == table) {
+            return *s_registry[i].index.load(std::memory_order_relaxed);
+        }
+
+        if (found == nullptr) {
+            break;
+        }
+    }
+
+    FastCriticalSectionClass::LockClass lock(s_indexLock);
+    std::unique_ptr<INIParseIndex> &index = s_indices[table];
+
+    if (index == nullptr) {
+        index.reset(new INIParseIndex);
+        index->Build(table);
+
+        if (s_registryCount < REGISTRY_MAX) {
+            uint32_t i = start;
+
+            while (s_registry[i].table.load(std::memory_order_relaxed) != nullptr) {
+                i = (i + 1) & mask;
+            }
+
+            s_registry[i].index.store(index.get(), std::memory_order_relaxed);
+            s_registry[i].table.store(table, std::memory_order_release);
+            ++s_registryCount;
+        }
+    }
+
+    return *index;
+}
+
+template<typename T> void INIParseIndex::Build(T const *table)
+{
+    for (T const *entry = table; entry->token != nullptr; ++entry) {
+        m_tokens.push_back(entry->token);
+    }
+
+    // Keep the load factor at or below a half so probe sequences stay short.
+    size_t capacity = 8;
+
+    while (capacity < m_tokens.size() * 2) {
+        capacity *= 2;
+    }
+
+    Slot empty = { 0, -1 };
+    m_slots.assign(capacity, empty);
+
+    for (int i = 0; i < Get_Size(); ++i) {
+        uint32_t hash = Hash_Token(m_tokens[i]);
+        size_t slot = hash & (capacity - 1);
+
+        while (m_slots[slot].index >= 0
+            && (m_slots[slot].hash != hash || strcmp(m_tokens[m_slots[slot].index], m_tokens[i]) != 0)) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+
+        // Later duplicates are never reached by a linear search so leave them out.
+        if (m_slots[slot].index < 0) {
+            m_slots[slot].hash = hash;
+            m_slots[slot].index = i;
+        }
+    }
+}
+
+/**
+ * @brief FNV-1a hash of a token.
+ */
+uint32_t INIParseIndex::Hash_Token(const char *token)
+{
+    uint32_t hash = 2166136261u;
+
+    for (const unsigned char *c = reinterpret_cast<const unsigned char *>(token); *c != '\0'; ++c) {
+        hash = (hash ^ *c) * 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Fibonacci hash of a table address, the high bits of the product are the well mixed ones.
+ */
+uint32_t INIParseIndex::Hash_Table(const void *table)
+{
+    return (uint32_t(uintptr_t(table) >> 3) * 2654435761u) >> 16;
+}
+#endif
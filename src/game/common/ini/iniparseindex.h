@@ -0,0 +1,58 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Hash lookup of tokens in INI parse tables.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+
+// The original binary searches parse tables linearly.
+#ifndef GAME_DLL
+#include <vector>
+
+struct BlockParse;
+struct FieldParse;
+
+/**
+ * Open addressing hash table over the tokens of a FieldParse or BlockParse table. Parse tables are static so an index
+ * is built the first time a table is searched and kept for the rest of the run. Finding an index is safe from several
+ * threads at once and only takes a lock when the index has to be built. Tokens match exactly as they would with
+ * strcmp, the first of any duplicates wins just like a linear search of the table.
+ */
+class INIParseIndex
+{
+public:
+    static INIParseIndex const &Get(FieldParse const *table);
+    static INIParseIndex const &Get(BlockParse const *table);
+    static uint64_t Get_Compares_Saved();
+
+    int Find(const char *token) const;
+    int Get_Size() const { return int(m_tokens.size()); }
+
+private:
+    struct Slot
+    {
+        uint32_t hash;
+        int index; // Index in the parse table, negative for an empty slot.
+    };
+
+    template<typename T> static INIParseIndex const &Get_Index(T const *table);
+    template<typename T> void Build(T const *table);
+    static uint32_t Hash_Token(const char *token);
+    static uint32_t Hash_Table(const void *table);
+
+private:
+    std::vector<const char *> m_tokens;
+    std::vector<Slot> m_slots; // Size is always a power of two at least twice the number of tokens.
+};
+#endif
@@ -15,6 +15,10 @@
 #include "namekeygenerator.h"
 #include <cctype>
 
+#ifndef GAME_DLL
+#include "asciiatom.h"
+#endif
+
 using std::tolower;
 
 #ifndef GAME_DLL
@@ -87,7 +91,12 @@ NameKeyType NameKeyGenerator::Name_To_Lower_Case_Key(const char *name)
 
     bucket = new Bucket;
     bucket->m_key = (NameKeyType)m_nextID++;
+#ifndef GAME_DLL
+    // Names live as long as the game so copies handed out by Key_To_Name can share the interned data.
+    bucket->m_nameString = Utf8Atom(name).To_String();
+#else
     bucket->m_nameString = name;
+#endif
     bucket->m_nextInSocket = m_sockets[socket_hash];
     m_sockets[socket_hash] = bucket;
 
@@ -120,7 +129,12 @@ NameKeyType NameKeyGenerator::Name_To_Key(const char *name)
 
     bucket = new Bucket;
     bucket->m_key = (NameKeyType)m_nextID++;
+#ifndef GAME_DLL
+    // Names live as long as the game so copies handed out by Key_To_Name can share the interned data.
+    bucket->m_nameString = Utf8Atom(name).To_String();
+#else
     bucket->m_nameString = name;
+#endif
     bucket->m_nextInSocket = m_sockets[socket_hash];
     m_sockets[socket_hash] = bucket;
 
@@ -13,6 +13,7 @@
  *            LICENSE
  */
 #include "archivefile.h"
+#include "archivefileindex.h"
 #include "file.h"
 
 ArchivedFileInfo *ArchiveFile::Get_Archived_File_Info(Utf8String const &filename)
@@ -135,6 +136,29 @@ void ArchiveFile::Get_File_List_From_Dir(DetailedArchiveDirectoryInfo const *dir
     }
 }
 
+// Adds every file in the archive to a file system wide index under its full path.
+void ArchiveFile::Add_To_Index(ArchiveFileIndex &index, Utf8String const &archive_name, bool overwrite)
+{
+    Add_To_Index(&m_archiveInfo, "", index, archive_name, overwrite);
+}
+
+void ArchiveFile::Add_To_Index(DetailedArchiveDirectoryInfo const *dir_info, Utf8String const &dirpath,
+    ArchiveFileIndex &index, Utf8String const &archive_name, bool overwrite)
+{
+    for (auto it = dir_info->directories.begin(); it != dir_info->directories.end(); ++it) {
+        Utf8String path = dirpath;
+        path += it->second.name;
+        path += "/";
+        Add_To_Index(&(it->second), path, index, archive_name, overwrite);
+    }
+
+    for (auto it = dir_info->files.begin(); it != dir_info->files.end(); ++it) {
+        Utf8String path = dirpath;
+        path += it->second.file_name;
+        index.Insert(path.Str(), this, archive_name, &it->second, overwrite);
+    }
+}
+
 // Helper funtion to check if a string matches the search string.
 bool ArchiveFile::Search_String_Matches(Utf8String string, Utf8String search)
 {
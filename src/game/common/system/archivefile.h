@@ -23,6 +23,7 @@
 
 struct FileInfo;
 class File;
+class ArchiveFileIndex;
 
 struct ArchivedFileInfo
 {
@@ -58,12 +59,15 @@ public:
     void Attach_File(File *file);
     void Get_File_List_From_Dir(Utf8String const &subdir, Utf8String const &dirpath, Utf8String const &filter,
         std::set<Utf8String, rts::less_than_nocase<Utf8String>> &filelist, bool search_subdir) const;
+    void Add_To_Index(ArchiveFileIndex &index, Utf8String const &archive_name, bool overwrite);
 
 protected:
     static bool Search_String_Matches(Utf8String string, Utf8String search);
     void Get_File_List_From_Dir(DetailedArchiveDirectoryInfo const *dir_info, Utf8String const &dirpath,
         Utf8String const &filter, std::set<Utf8String, rts::less_than_nocase<Utf8String>> &filelist,
         bool search_subdir) const;
+    void Add_To_Index(DetailedArchiveDirectoryInfo const *dir_info, Utf8String const &dirpath, ArchiveFileIndex &index,
+        Utf8String const &archive_name, bool overwrite);
 
     File *m_backingFile;
     DetailedArchiveDirectoryInfo m_archiveInfo;
@@ -0,0 +1,220 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Flat hash index of every file held by the loaded archives.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "archivefileindex.h"
+#include <cctype>
+#include <cstring>
+
+using std::strlen;
+using std::tolower;
+
+namespace
+{
+/**
+ * @brief Reads a path a character at a time in normalised form, lower case with single forward slashes between
+ * elements.
+ */
+class PathReader
+{
+public:
+    PathReader(const char *path) : m_path(path), m_started(false) {}
+
+    char Next()
+    {
+        if (*m_path == '\\' || *m_path == '/') {
+            while (*m_path == '\\' || *m_path == '/') {
+                ++m_path;
+            }
+
+            if (*m_path == '\0') {
+                return '\0';
+            }
+
+            if (m_started) {
+                return '/';
+            }
+        }
+
+        if (*m_path == '\0') {
+            return '\0';
+        }
+
+        m_started = true;
+
+        return char(tolower(uint8_t(*m_path++)));
+    }
+
+private:
+    const char *m_path;
+    bool m_started;
+};
+
+bool Path_Matches(const char *normalised, const char *path)
+{
+    PathReader reader(path);
+
+    for (;; ++normalised) {
+        char c = reader.Next();
+
+        if (c != *normalised) {
+            return false;
+        }
+
+        if (c == '\0') {
+            return true;
+        }
+    }
+}
+} // namespace
+
+/**
+ * @brief Hashes the normalised form of a path with 64 bit FNV-1a.
+ */
+uint64_t ArchiveFileIndex::Hash_Path(const char *path)
+{
+    PathReader reader(path);
+    uint64_t hash = 14695981039346656037ull;
+
+    for (char c = reader.Next(); c != '\0'; c = reader.Next()) {
+        hash = (hash ^ uint8_t(c)) * 1099511628211ull;
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Adds a file to the index, an existing entry for the path is only replaced if overwrite is set.
+ */
+void ArchiveFileIndex::Insert(
+    const char *path, ArchiveFile *archive, Utf8String const &archive_name, ArchivedFileInfo const *info, bool overwrite)
+{
+    // Keep the load factor at or below a half so probe sequences stay short.
+    if (size_t(m_count + 1) * 2 > m_entries.size()) {
+        Grow();
+    }
+
+    uint64_t hash = Hash_Path(path);
+    Entry &entry = m_entries[Find_Slot(path, hash)];
+
+    if (entry.archive != nullptr && !overwrite) {
+        return;
+    }
+
+    if (entry.archive == nullptr) {
+        char *buffer = entry.path.Get_Buffer_For_Read(int(strlen(path)));
+        PathReader reader(path);
+        int len = 0;
+
+        for (char c = reader.Next(); c != '\0'; c = reader.Next()) {
+            buffer[len++] = c;
+        }
+
+        buffer[len] = '\0';
+
+        if (len == 0) {
+            entry.path.Clear();
+            return;
+        }
+
+        entry.hash = hash;
+        ++m_count;
+    }
+
+    entry.archive_name = archive_name;
+    entry.archive = archive;
+    entry.info = info;
+    ++m_generation;
+}
+
+/**
+ * @brief Finds the entry for a path, returns nullptr if no loaded archive holds it.
+ */
+ArchiveFileIndex::Entry const *ArchiveFileIndex::Find(const char *path) const
+{
+    if (m_count == 0) {
+        return nullptr;
+    }
+
+    Entry const &entry = m_entries[Find_Slot(path, Hash_Path(path))];
+
+    return entry.archive != nullptr ? &entry : nullptr;
+}
+
+/**
+ * @brief Drops every entry pointing at an archive that is being closed, the normalised paths of the dropped entries
+ * are added to removed so they can be filled in again from any other archive that holds them.
+ */
+void ArchiveFileIndex::Remove_Archive(ArchiveFile const *archive, std::vector<Utf8String> &removed)
+{
+    std::vector<Entry> entries;
+    entries.swap(m_entries);
+    m_count = 0;
+    ++m_generation;
+
+    // Removal is rare enough that rebuilding is simpler than tombstones.
+    for (Entry &entry : entries) {
+        if (entry.archive == nullptr) {
+            continue;
+        }
+
+        if (entry.archive == archive) {
+            removed.push_back(entry.path);
+        } else {
+            Insert(entry.path.Str(), entry.archive, entry.archive_name, entry.info, false);
+        }
+    }
+}
+
+void ArchiveFileIndex::Clear()
+{
+    m_entries.clear();
+    m_count = 0;
+    ++m_generation;
+}
+
+/**
+ * @brief Finds the slot holding a path or the empty slot it would go in.
+ */
+size_t ArchiveFileIndex::Find_Slot(const char *path, uint64_t hash) const
+{
+    size_t mask = m_entries.size() - 1;
+
+    for (size_t i = size_t(hash) & mask;; i = (i + 1) & mask) {
+        Entry const &entry = m_entries[i];
+
+        if (entry.archive == nullptr || (entry.hash == hash && Path_Matches(entry.path.Str(), path))) {
+            return i;
+        }
+    }
+}
+
+void ArchiveFileIndex::Grow()
+{
+    std::vector<Entry> entries(m_entries.empty() ? size_t(MIN_CAPACITY) : m_entries.size() * 2);
+    entries.swap(m_entries);
+
+    // Paths are already normalised and hashed so entries move straight into their new slots.
+    for (Entry &entry : entries) {
+        if (entry.archive != nullptr) {
+            size_t mask = m_entries.size() - 1;
+            size_t i = size_t(entry.hash) & mask;
+
+            while (m_entries[i].archive != nullptr) {
+                i = (i + 1) & mask;
+            }
+
+            m_entries[i] = entry;
+        }
+    }
+}
@@ -0,0 +1,66 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Flat hash index of every file held by the loaded archives.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "asciistring.h"
+#include <vector>
+
+class ArchiveFile;
+struct ArchivedFileInfo;
+
+/**
+ * Open addressing hash table keyed by the normalised full path of a file, paths are matched case insensitively with
+ * either slash as the separator and repeated or leading separators ignored. Lookups hash and compare the path as
+ * given so they never allocate.
+ */
+class ArchiveFileIndex
+{
+    enum
+    {
+        MIN_CAPACITY = 1024,
+    };
+
+public:
+    struct Entry
+    {
+        uint64_t hash;
+        Utf8String path;
+        Utf8String archive_name;
+        ArchiveFile *archive;
+        ArchivedFileInfo const *info;
+    };
+
+    ArchiveFileIndex() : m_count(0), m_generation(0) {}
+
+    void Insert(const char *path, ArchiveFile *archive, Utf8String const &archive_name, ArchivedFileInfo const *info,
+        bool overwrite);
+    Entry const *Find(const char *path) const;
+    void Remove_Archive(ArchiveFile const *archive, std::vector<Utf8String> &removed);
+    void Clear();
+    int Get_Count() const { return m_count; }
+    unsigned Get_Generation() const { return m_generation; }
+
+    static uint64_t Hash_Path(const char *path);
+
+private:
+    size_t Find_Slot(const char *path, uint64_t hash) const;
+    void Grow();
+
+private:
+    std::vector<Entry> m_entries; // Size is always zero or a power of two, empty slots have a null archive.
+    int m_count;
+    unsigned m_generation; // Bumped on every change so cached lookups can tell when they are stale.
+};
@@ -15,6 +15,7 @@
 #include "archivefilesystem.h"
 #include "archivefile.h"
 #include "globaldata.h"
+#include <algorithm>
 #include <captainslog.h>
 
 #ifndef GAME_DLL
@@ -23,6 +24,15 @@ ArchiveFileSystem *g_theArchiveFileSystem = nullptr;
 
 File *ArchiveFileSystem::Open_File(const char *filename, int mode)
 {
+#ifndef GAME_DLL
+    ArchiveFileIndex::Entry const *entry = m_fileIndex.Find(filename);
+
+    if (entry == nullptr) {
+        return nullptr;
+    }
+
+    return entry->archive->Open_File(filename, mode);
+#else
     Utf8String archive = Get_Archive_Filename_For_File(filename);
 
     if (archive.Is_Empty()) {
@@ -34,10 +44,14 @@ File *ArchiveFileSystem::Open_File(const char *filename, int mode)
     captainslog_dbgassert(file != nullptr, "Did not find matching archive file.");
 
     return file->Open_File(filename, mode);
+#endif
 }
 
 bool ArchiveFileSystem::Does_File_Exist(const char *filename)
 {
+#ifndef GAME_DLL
+    return m_fileIndex.Find(filename) != nullptr;
+#else
     Utf8String path = filename;
     Utf8String token;
     ArchivedDirectoryInfo *dirp = &m_archiveDirInfo;
@@ -66,12 +80,19 @@ bool ArchiveFileSystem::Does_File_Exist(const char *filename)
     }
 
     return true;
+#endif
 }
 
 // Loads an archive file into the virtual directory tree. The over write option allows it to use this archive to
 // replace the backing for a file name if it already has an entry in the tree.
 void ArchiveFileSystem::Load_Into_Dir_Tree(ArchiveFile const *file, Utf8String const &archive_path, bool overwrite)
 {
+#ifndef GAME_DLL
+    // The index hands out the archive to open files from, it is owned by m_archiveFiles.
+    LoadedArchive loaded = { const_cast<ArchiveFile *>(file), archive_path, overwrite };
+    loaded.archive->Add_To_Index(m_fileIndex, archive_path, overwrite);
+    m_loadOrder.push_back(loaded);
+#else
     std::set<Utf8String, rts::less_than_nocase<Utf8String>> file_list;
 
     // Retrieve a list of files in the archive
@@ -105,14 +126,55 @@ void ArchiveFileSystem::Load_Into_Dir_Tree(ArchiveFile const *file, Utf8String c
             dirp->files[token] = archive_path;
         }
     }
+#endif
 }
 
+#ifndef GAME_DLL
+/**
+ * @brief Removes an archive that is being closed from the index. Files it provided may still be held by other loaded
+ * archives, they are added back in load order with the flags each archive was loaded with so the index ends up as if
+ * the closed archive had never been loaded.
+ */
+void ArchiveFileSystem::Remove_From_Dir_Tree(ArchiveFile const *file)
+{
+    std::vector<Utf8String> removed;
+    m_fileIndex.Remove_Archive(file, removed);
+    m_loadOrder.erase(std::remove_if(m_loadOrder.begin(),
+                          m_loadOrder.end(),
+                          [file](LoadedArchive const &loaded) { return loaded.archive == file; }),
+        m_loadOrder.end());
+
+    if (removed.empty()) {
+        return;
+    }
+
+    for (LoadedArchive const &loaded : m_loadOrder) {
+        for (Utf8String const &path : removed) {
+            ArchivedFileInfo *info = loaded.archive->Get_Archived_File_Info(path);
+
+            if (info != nullptr) {
+                m_fileIndex.Insert(path.Str(), loaded.archive, loaded.name, info, loaded.overwrite);
+            }
+        }
+    }
+}
+#endif
+
 bool ArchiveFileSystem::Get_File_Info(Utf8String const &name, FileInfo *info)
 {
     if (info == nullptr || name.Is_Empty()) {
         return false;
     }
 
+#ifndef GAME_DLL
+    ArchiveFileIndex::Entry const *entry = m_fileIndex.Find(name.Str());
+
+    if (entry == nullptr) {
+        return false;
+    }
+
+    return entry->archive->Get_File_Info(name, info);
+#else
     // Find the archive that corresponds to this file name.
     Utf8String archive = Get_Archive_Filename_For_File(name);
 
@@ -122,11 +184,17 @@ bool ArchiveFileSystem::Get_File_Info(Utf8String const &name, FileInfo *info)
     }
 
     return m_archiveFiles[archive]->Get_File_Info(name, info);
+#endif
 }
 
 // Returns the filname of the archive file containing the passed in file name.
 Utf8String ArchiveFileSystem::Get_Archive_Filename_For_File(Utf8String const &filename)
 {
+#ifndef GAME_DLL
+    ArchiveFileIndex::Entry const *entry = m_fileIndex.Find(filename.Str());
+
+    return entry != nullptr ? entry->archive_name : Utf8String();
+#else
     Utf8String path = filename;
     Utf8String token;
     ArchivedDirectoryInfo *dirp = &m_archiveDirInfo;
@@ -154,8 +222,28 @@ Utf8String ArchiveFileSystem::Get_Archive_Filename_For_File(Utf8String const &fi
     }
 
     return dirp->files[token];
+#endif
 }
 
+#ifndef GAME_DLL
+// Finds where a file lives inside its archive so it can be read through a handle of the caller's own. Safe to call from
+// other threads as long as no archives are being loaded or closed at the same time.
+bool ArchiveFileSystem::Get_Archived_File_Location(const char *filename, Utf8String &archive, int &position, int &size)
+{
+    ArchiveFileIndex::Entry const *entry = m_fileIndex.Find(filename);
+
+    if (entry == nullptr) {
+        return false;
+    }
+
+    archive = entry->archive_name;
+    position = entry->info->position;
+    size = entry->info->size;
+
+    return true;
+}
+#endif
+
 // Populates a std::set of file paths based on the passed in filter and path to examine.
 void ArchiveFileSystem::Get_File_List_From_Dir(Utf8String const &subdir, Utf8String const &dirpath,
     Utf8String const &filter, std::set<Utf8String, rts::less_than_nocase<Utf8String>> &filelist, bool search_subdirs)
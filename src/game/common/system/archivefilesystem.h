@@ -15,10 +15,12 @@
 #pragma once
 
 #include "always.h"
+#include "archivefileindex.h"
 #include "rtsutils.h"
 #include "subsysteminterface.h"
 #include <map>
 #include <set>
+#include <vector>
 
 class File;
 class ArchiveFile;
@@ -50,10 +52,31 @@ public:
     void Get_File_List_From_Dir(Utf8String const &subdir, Utf8String const &dirpath, Utf8String const &filter,
         std::set<Utf8String, rts::less_than_nocase<Utf8String>> &filelist, bool search_subdirs);
     void Load_Mods();
+#ifndef GAME_DLL
+    bool Get_Archived_File_Location(const char *filename, Utf8String &archive, int &position, int &size);
+    unsigned Get_Generation() const { return m_fileIndex.Get_Generation(); } // Changes when archives are loaded or closed.
+#endif
 
 protected:
+#ifndef GAME_DLL
+    struct LoadedArchive
+    {
+        ArchiveFile *archive;
+        Utf8String name;
+        bool overwrite;
+    };
+
+    void Remove_From_Dir_Tree(ArchiveFile const *file);
+#endif
+
     std::map<Utf8String, ArchiveFile *> m_archiveFiles;
+#ifdef GAME_DLL
     ArchivedDirectoryInfo m_archiveDirInfo;
+#else
+    // Finding a file is a single hash probe, directory listings walk the trees of the archives themselves.
+    ArchiveFileIndex m_fileIndex;
+    std::vector<LoadedArchive> m_loadOrder; // Archives in the order they were added to the index, oldest first.
+#endif
 };
 
 #ifdef GAME_DLL
@@ -0,0 +1,212 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief On disk cache of archive headers so they don't have to be parsed on every launch.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "archiveindexcache.h"
+#include "cachefile.h"
+#include "localfilesystem.h"
+#include "rtsutils.h"
+#include <captainslog.h>
+#include <cstring>
+
+using rts::Cache_Pad_Size;
+using rts::Cache_Put_Data;
+using rts::Cache_Put_Int;
+using rts::Cache_Put_Padding;
+using rts::Cache_Put_String;
+using rts::CacheReader;
+using rts::FourCC;
+using std::memcmp;
+using std::memcpy;
+
+/**
+ * @brief Reads a cache file, returns false and leaves the cache empty if it is missing or not valid.
+ */
+bool ArchiveIndexCache::Load(const char *filename)
+{
+    Clear();
+
+    File *file = g_theLocalFileSystem->Open_File(filename, File::READ | File::BINARY);
+
+    if (file == nullptr) {
+        return false;
+    }
+
+    int size = file->Size();
+
+    if (size <= 0) {
+        file->Close();
+        return false;
+    }
+
+    m_buffer = new uint8_t[size];
+    int read = file->Read(m_buffer, size);
+    file->Close();
+
+    CacheReader reader(m_buffer, read > 0 ? uint32_t(read) : 0);
+    uint32_t fourcc;
+    uint32_t version;
+    uint32_t archive_count;
+    uint32_t total_size;
+
+    // The total size catches a cache that was only partly written.
+    if (!reader.Get_Int(fourcc) || !reader.Get_Int(version) || !reader.Get_Int(archive_count)
+        || !reader.Get_Int(total_size) || fourcc != FourCC<'T', 'B', 'I', 'C'>::value || version != CACHE_VERSION
+        || total_size != uint32_t(size) || read != size) {
+        captainslog_info("Archive index cache '%s' is out of date, archives will be parsed again.", filename);
+        Clear();
+
+        return false;
+    }
+
+    for (uint32_t i = 0; i < archive_count; ++i) {
+        uint32_t path_size;
+        uint32_t count;
+        uint32_t names_size;
+        const uint8_t *path;
+        const uint8_t *info;
+        const uint8_t *entries;
+        const uint8_t *names;
+
+        if (!reader.Get_Int(path_size) || (path = reader.Get(path_size)) == nullptr
+            || (info = reader.Get(sizeof(FileInfo))) == nullptr || !reader.Get_Int(count) || !reader.Get_Int(names_size)
+            || count > size / sizeof(Entry) || (entries = reader.Get(count * sizeof(Entry))) == nullptr
+            || (names = reader.Get(names_size)) == nullptr || path_size == 0 || path[path_size - 1] != '\0'
+            || (count > 0 && (names_size == 0 || names[names_size - 1] != '\0'))) {
+            captainslog_error("Archive index cache '%s' is corrupt, archives will be parsed again.", filename);
+            Clear();
+
+            return false;
+        }
+
+        Entry const *entry_table = reinterpret_cast<Entry const *>(entries);
+
+        for (uint32_t j = 0; j < count; ++j) {
+            if (entry_table[j].name >= names_size) {
+                captainslog_error("Archive index cache '%s' is corrupt, archives will be parsed again.", filename);
+                Clear();
+
+                return false;
+            }
+        }
+
+        CachedArchive &archive = m_archives[reinterpret_cast<const char *>(path)];
+        memcpy(&archive.info, info, sizeof(archive.info));
+        archive.entries = entry_table;
+        archive.names = reinterpret_cast<const char *>(names);
+        archive.count = int(count);
+        archive.names_size = int(names_size);
+        archive.used = false;
+    }
+
+    captainslog_info("Loaded archive index cache '%s' holding %u archives.", filename, archive_count);
+
+    return true;
+}
+
+/**
+ * @brief Writes out the tables of the archives used this session along with any others that still exist.
+ */
+bool ArchiveIndexCache::Save(const char *filename)
+{
+    std::vector<uint8_t> buffer;
+    uint32_t archive_count = 0;
+
+    Cache_Put_Int(buffer, FourCC<'T', 'B', 'I', 'C'>::value);
+    Cache_Put_Int(buffer, CACHE_VERSION);
+    Cache_Put_Int(buffer, 0);
+    Cache_Put_Int(buffer, 0);
+
+    for (auto it = m_archives.begin(); it != m_archives.end(); ++it) {
+        CachedArchive const &archive = it->second;
+
+        // Archives from other sessions are kept unless they have since been removed.
+        if (!archive.used && !g_theLocalFileSystem->Does_File_Exist(it->first.Str())) {
+            continue;
+        }
+
+        Cache_Put_String(buffer, it->first.Str(), uint32_t(it->first.Get_Length()));
+        Cache_Put_Data(buffer, &archive.info, sizeof(archive.info));
+        Cache_Put_Int(buffer, uint32_t(archive.count));
+        Cache_Put_Int(buffer, Cache_Pad_Size(archive.names_size));
+        Cache_Put_Data(buffer, archive.entries, archive.count * sizeof(Entry));
+        Cache_Put_Data(buffer, archive.names, archive.names_size);
+        Cache_Put_Padding(buffer);
+        ++archive_count;
+    }
+
+    uint32_t total_size = uint32_t(buffer.size());
+    memcpy(&buffer[8], &archive_count, sizeof(archive_count));
+    memcpy(&buffer[12], &total_size, sizeof(total_size));
+
+    File *file = g_theLocalFileSystem->Open_File(filename, File::WRITE | File::CREATE | File::TRUNCATE | File::BINARY);
+
+    if (file == nullptr) {
+        captainslog_warn("Couldn't write archive index cache '%s'.", filename);
+        return false;
+    }
+
+    bool written = file->Write(buffer.data(), int(buffer.size())) == int(buffer.size());
+    file->Close();
+    m_dirty = !written;
+
+    return written;
+}
+
+void ArchiveIndexCache::Clear()
+{
+    m_archives.clear();
+    delete[] m_buffer;
+    m_buffer = nullptr;
+    m_dirty = false;
+}
+
+/**
+ * @brief Gets the cached file table of an archive, fails if it isn't cached or the archive changed since.
+ */
+bool ArchiveIndexCache::Find(
+    Utf8String const &archive, FileInfo const &info, Entry const *&entries, const char *&names, int &count)
+{
+    FastCriticalSectionClass::LockClass lock(m_lock);
+    auto it = m_archives.find(archive);
+
+    if (it == m_archives.end() || memcmp(&it->second.info, &info, sizeof(info)) != 0) {
+        return false;
+    }
+
+    it->second.used = true;
+    entries = it->second.entries;
+    names = it->second.names;
+    count = it->second.count;
+
+    return true;
+}
+
+/**
+ * @brief Stores the file table of an archive that had to be parsed, the vectors are taken over by the cache.
+ */
+void ArchiveIndexCache::Add_Archive(
+    Utf8String const &archive, FileInfo const &info, std::vector<Entry> &entries, std::vector<char> &names)
+{
+    FastCriticalSectionClass::LockClass lock(m_lock);
+    CachedArchive &cached = m_archives[archive];
+    cached.info = info;
+    cached.owned_entries.swap(entries);
+    cached.owned_names.swap(names);
+    cached.entries = cached.owned_entries.data();
+    cached.names = cached.owned_names.data();
+    cached.count = int(cached.owned_entries.size());
+    cached.names_size = int(cached.owned_names.size());
+    cached.used = true;
+    m_dirty = true;
+}
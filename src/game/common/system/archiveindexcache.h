@@ -0,0 +1,72 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief On disk cache of archive headers so they don't have to be parsed on every launch.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "asciistring.h"
+#include "critsection.h"
+#include "file.h"
+#include <map>
+#include <vector>
+
+/**
+ * Holds the file table of each archive keyed by the archive path, size and modification time. The cache file is read
+ * in one go and tables are handed out straight from that buffer, an archive that changed on disk is simply parsed
+ * again and replaces its old table the next time the cache is saved. Finding and adding archives is safe from several
+ * threads at once.
+ */
+class ArchiveIndexCache
+{
+    enum
+    {
+        CACHE_VERSION = 1,
+    };
+
+public:
+    struct Entry
+    {
+        int32_t position;
+        int32_t size;
+        uint32_t name; // Offset of the full path in the archive's name table.
+    };
+
+    ArchiveIndexCache() : m_buffer(nullptr), m_dirty(false) {}
+    ~ArchiveIndexCache() { Clear(); }
+
+    bool Load(const char *filename);
+    bool Save(const char *filename);
+    void Clear();
+    bool Find(Utf8String const &archive, FileInfo const &info, Entry const *&entries, const char *&names, int &count);
+    void Add_Archive(Utf8String const &archive, FileInfo const &info, std::vector<Entry> &entries, std::vector<char> &names);
+    bool Is_Dirty() const { return m_dirty; }
+
+private:
+    struct CachedArchive
+    {
+        FileInfo info;
+        Entry const *entries;
+        const char *names;
+        int count;
+        int names_size;
+        bool used;
+        std::vector<Entry> owned_entries; // Only filled for archives parsed this session.
+        std::vector<char> owned_names;
+    };
+
+    uint8_t *m_buffer;
+    std::map<Utf8String, CachedArchive> m_archives;
+    bool m_dirty;
+    FastCriticalSectionClass m_lock;
+};
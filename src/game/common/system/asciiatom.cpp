@@ -0,0 +1,154 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Interned immutable strings that compare by pointer.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "asciiatom.h"
+
+#ifndef GAME_DLL
+#include "critsection.h"
+#include "rawalloc.h"
+#include <atomic>
+#include <cstring>
+#include <new>
+
+using std::memcmp;
+using std::memcpy;
+using std::strlen;
+
+namespace
+{
+/**
+ * @brief Entry in the atom table, the string data follows it in the same allocation.
+ */
+struct AtomNode
+{
+    std::atomic<AtomNode *> next;
+    uint32_t hash;
+    int length;
+    Utf8String::AsciiStringData data;
+};
+
+// Buckets are read without a lock, new nodes are only ever pushed onto the front of a chain.
+std::atomic<AtomNode *> s_atomBuckets[Utf8Atom::BUCKET_COUNT];
+std::atomic<int> s_atomCount(0);
+FastCriticalSectionClass s_atomLock;
+
+uint32_t Atom_Hash(const char *s, int len)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+
+    for (int i = 0; i < len; ++i) {
+        hash = (hash ^ uint8_t(s[i])) * 16777619u;
+    }
+
+    return hash;
+}
+} // namespace
+
+Utf8Atom::Utf8Atom(const Utf8String &s) : m_data(nullptr)
+{
+    // Already interned strings can be adopted directly.
+    if (s.m_data != nullptr && s.m_data->ref_count.load(std::memory_order_relaxed) == Utf8String::IMMORTAL_REF_COUNT) {
+        m_data = s.m_data;
+    } else {
+        m_data = Intern(s.Str());
+    }
+}
+
+/**
+ * @brief Gets a Utf8String sharing the interned data, it is never reference counted or freed.
+ */
+Utf8String Utf8Atom::To_String() const
+{
+    Utf8String string;
+    string.m_data = m_data;
+
+    return string;
+}
+
+/**
+ * @brief Gets the atom for a string only if it was already interned, returns an empty atom otherwise.
+ */
+Utf8Atom Utf8Atom::Find(const char *s)
+{
+    Utf8Atom atom;
+
+    if (s != nullptr && *s != '\0') {
+        int len = int(strlen(s));
+        atom.m_data = Lookup(s, len, Atom_Hash(s, len));
+    }
+
+    return atom;
+}
+
+int Utf8Atom::Get_Atom_Count()
+{
+    return s_atomCount.load(std::memory_order_relaxed);
+}
+
+Utf8String::AsciiStringData *Utf8Atom::Intern(const char *s)
+{
+    if (s == nullptr || *s == '\0') {
+        return nullptr;
+    }
+
+    int len = int(strlen(s));
+    captainslog_dbgassert(len < Utf8String::MAX_LEN, "String too long to intern.");
+    uint32_t hash = Atom_Hash(s, len);
+    Utf8String::AsciiStringData *data = Lookup(s, len, hash);
+
+    if (data != nullptr) {
+        return data;
+    }
+
+    FastCriticalSectionClass::LockClass lock(s_atomLock);
+
+    // Another thread may have interned the same string while we waited for the lock.
+    data = Lookup(s, len, hash);
+
+    if (data != nullptr) {
+        return data;
+    }
+
+    AtomNode *node = static_cast<AtomNode *>(Raw_Allocate_No_Zero(sizeof(AtomNode) + len + 1));
+    node->hash = hash;
+    node->length = len;
+    new (&node->data.ref_count) std::atomic<uint16_t>(uint16_t(Utf8String::IMMORTAL_REF_COUNT));
+    node->data.num_chars_allocated = len + 1;
+#ifdef GAME_DEBUG_STRUCTS
+    node->data.debug_ptr = node->data.Peek();
+#endif
+    memcpy(node->data.Peek(), s, len + 1);
+
+    std::atomic<AtomNode *> &bucket = s_atomBuckets[hash & (BUCKET_COUNT - 1)];
+    new (&node->next) std::atomic<AtomNode *>(bucket.load(std::memory_order_relaxed));
+    bucket.store(node, std::memory_order_release);
+    s_atomCount.fetch_add(1, std::memory_order_relaxed);
+
+    return &node->data;
+}
+
+Utf8String::AsciiStringData *Utf8Atom::Lookup(const char *s, int len, uint32_t hash)
+{
+    AtomNode *node = s_atomBuckets[hash & (BUCKET_COUNT - 1)].load(std::memory_order_acquire);
+
+    for (; node != nullptr; node = node->next.load(std::memory_order_acquire)) {
+        if (node->hash == hash && node->length == len && memcmp(node->data.Peek(), s, len) == 0) {
+            return &node->data;
+        }
+    }
+
+    return nullptr;
+}
+#endif
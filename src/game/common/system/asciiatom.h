@@ -0,0 +1,61 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Interned immutable strings that compare by pointer.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "asciistring.h"
+
+// Relies on immortal reference counts which only the standalone Utf8String supports.
+#ifndef GAME_DLL
+/**
+ * @brief Handle to a string interned for the lifetime of the process.
+ *
+ * Creating an atom looks the string up in a global table, atoms made from equal strings always share the same data
+ * so comparing them is a pointer compare. Interned data is stored in the same form as Utf8String data with an
+ * immortal reference count, so To_String hands out a Utf8String that never allocates or reference counts when copied.
+ * Atoms are meant for names that live as long as the game does, interning strings that change all the time leaks.
+ */
+class Utf8Atom
+{
+public:
+    enum
+    {
+        BUCKET_COUNT = 4096,
+    };
+
+    Utf8Atom() : m_data(nullptr) {}
+    explicit Utf8Atom(const char *s) : m_data(Intern(s)) {}
+    explicit Utf8Atom(const Utf8String &s);
+
+    const char *Str() const { return m_data != nullptr ? m_data->Peek() : ""; }
+    bool Is_Empty() const { return m_data == nullptr; }
+    Utf8String To_String() const;
+
+    static Utf8Atom Find(const char *s);
+    static int Get_Atom_Count();
+
+    friend bool operator==(Utf8Atom left, Utf8Atom right) { return left.m_data == right.m_data; }
+    friend bool operator!=(Utf8Atom left, Utf8Atom right) { return left.m_data != right.m_data; }
+    // Orders by address so atoms can key ordered containers, the order is not alphabetical.
+    friend bool operator<(Utf8Atom left, Utf8Atom right) { return left.m_data < right.m_data; }
+
+private:
+    static Utf8String::AsciiStringData *Intern(const char *s);
+    static Utf8String::AsciiStringData *Lookup(const char *s, int len, uint32_t hash);
+
+private:
+    Utf8String::AsciiStringData *m_data;
+};
+#endif
@@ -67,10 +67,16 @@ char *Utf8String::Peek() const
 void Utf8String::Release_Buffer()
 {
     if (m_data != nullptr) {
+#ifndef GAME_DLL
+        if (m_data->Dec_Ref_Count()) {
+            Free_Bytes();
+        }
+#else
         m_data->Dec_Ref_Count();
         if (m_data->ref_count == 0) {
             Free_Bytes();
         }
+#endif
         m_data = nullptr;
     }
 }
@@ -219,13 +225,27 @@ void Utf8String::Translate(Utf16String const &string)
 {
     Release_Buffer();
 
+    // Most strings are plain ASCII which converts one character to one byte.
+    int ascii_len = string.Get_Length();
+
+    if (ascii_len > 0 && rts::Is_Ascii(string.Str(), ascii_len)) {
+        char *dst = Get_Buffer_For_Read(ascii_len);
+        rts::Narrow_Ascii(dst, string.Str(), ascii_len);
+        dst[ascii_len] = '\0';
+
+        return;
+    }
+
 #if defined BUILD_WITH_ICU // Use ICU convertors
     int32_t length;
     UErrorCode error = U_ZERO_ERROR;
     u_strToUTF8(nullptr, 0, &length, string, -1, &error);
 
-    if (U_SUCCESS(error) && length > 0) {
-        u_strToUTF8(Get_Buffer_For_Read(length), length, nullptr, string, -1, &error);
+    // Preflighting without a buffer reports an overflow but still gives the needed length.
+    if ((U_SUCCESS(error) || error == U_BUFFER_OVERFLOW_ERROR) && length > 0) {
+        error = U_ZERO_ERROR;
+        // Capacity includes the terminator so ICU null terminates the result.
+        u_strToUTF8(Get_Buffer_For_Read(length), length + 1, nullptr, string, -1, &error);
 
         if (U_FAILURE(error)) {
             Clear();
@@ -351,20 +371,19 @@ void Utf8String::Trim()
  */
 void Utf8String::To_Lower()
 {
-    // Size specifically matches original code for compatability
-    char buf[MAX_TO_LOWER_BUF_LEN];
-
     if (m_data == nullptr) {
         return;
     }
 
-    strcpy(buf, Peek());
+    int len = strlen(Peek());
 
-    for (char *c = buf; *c != '\0'; ++c) {
-        *c = tolower(*c);
+    // Already lower case strings, most paths in practice, keep sharing their buffer.
+    if (!rts::Has_Upper_Ascii(Peek(), len)) {
+        return;
     }
 
-    Set(buf);
+    Ensure_Unique_Buffer_Of_Size(len + 1, true);
+    rts::To_Lower_Ascii(Peek(), len);
 }
 
 /**
@@ -531,7 +550,7 @@ bool Utf8String::Starts_With_No_Case(const char *p) const
         return false;
     }
 
-    return strncasecmp(Peek(), p, thatlen) == 0;
+    return rts::Compare_No_Case(Peek(), p, thatlen) == 0;
 }
 
 /**
@@ -550,7 +569,7 @@ bool Utf8String::Ends_With_No_Case(const char *p) const
         return false;
     }
 
-    return strncasecmp(Peek() + thislen - thatlen, p, thatlen) == 0;
+    return rts::Compare_No_Case(Peek() + thislen - thatlen, p, thatlen) == 0;
 }
 
 /**
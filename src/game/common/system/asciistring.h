@@ -16,6 +16,7 @@
 
 #include "always.h"
 #include "memdynalloc.h"
+#include "stringsimd.h"
 #include <cstdarg>
 #include <cstring>
 
@@ -31,6 +32,7 @@ class Utf8String
     // So we can hook functions we think should be private.
     friend void Setup_Hooks();
     friend class Utf16String;
+    friend class Utf8Atom;
 
 public:
     enum
@@ -38,6 +40,10 @@ public:
         MAX_FORMAT_BUF_LEN = 2048,
         MAX_LEN = 32767,
         MAX_TO_LOWER_BUF_LEN = 2060,
+#ifndef GAME_DLL
+        // Reference count of interned data that is never freed, copies of it skip reference counting entirely.
+        IMMORTAL_REF_COUNT = 0xFFFF,
+#endif
     };
 
     struct AsciiStringData
@@ -53,23 +59,38 @@ public:
 #endif
         uint16_t num_chars_allocated;
 
+#ifndef GAME_DLL
         void Inc_Ref_Count()
         {
-#ifndef GAME_DLL
-            ++ref_count;
-#elif defined PLATFORM_WINDOWS
+            if (ref_count.load(std::memory_order_relaxed) != IMMORTAL_REF_COUNT) {
+                ref_count.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // Returns true when the last reference was released and the data should be freed.
+        bool Dec_Ref_Count()
+        {
+            if (ref_count.load(std::memory_order_relaxed) == IMMORTAL_REF_COUNT) {
+                return false;
+            }
+
+            return ref_count.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        }
+#else
+        void Inc_Ref_Count()
+        {
+#ifdef PLATFORM_WINDOWS
             InterlockedIncrement16((volatile short *)&ref_count);
 #endif
         }
 
         void Dec_Ref_Count()
         {
-#ifndef GAME_DLL
-            --ref_count;
-#elif defined PLATFORM_WINDOWS
+#ifdef PLATFORM_WINDOWS
             InterlockedDecrement16((volatile short *)&ref_count);
 #endif
         }
+#endif
 
         char *Peek()
         {
@@ -128,8 +149,8 @@ public:
     int Compare(const char *s) const { return strcmp(Str(), s); }
     int Compare(Utf8String const &string) const { return strcmp(Str(), string.Str()); }
 
-    int Compare_No_Case(const char *s) const { return strcasecmp(Str(), s); }
-    int Compare_No_Case(Utf8String const &string) const { return strcasecmp(Str(), string.Str()); }
+    int Compare_No_Case(const char *s) const { return rts::Compare_No_Case(Str(), s); }
+    int Compare_No_Case(Utf8String const &string) const { return rts::Compare_No_Case(Str(), string.Str()); }
 
     // I assume these do this, though have no examples in binaries.
     char *Find(char c) { return strchr(Peek(), c); }
@@ -143,7 +164,7 @@ public:
 
     bool Next_Token(Utf8String *tok, const char *seps = nullptr);
 
-    bool Is_None() const { return m_data != nullptr && strcasecmp(Peek(), "None") == 0; }
+    bool Is_None() const { return m_data != nullptr && rts::Compare_No_Case(Peek(), "None") == 0; }
     bool Is_Empty() const { return m_data == nullptr || *m_data->Peek() == '\0'; }
     bool Is_Not_Empty() const { return !Is_Empty(); }
     bool Is_Not_None() const { return !Is_None(); }
@@ -151,10 +172,19 @@ public:
     Utf8String Posix_Path() const;
     Utf8String Windows_Path() const;
 
-    friend bool operator==(Utf8String const &left, Utf8String const &right) { return left.Compare(right) == 0; }
+    friend bool operator==(Utf8String const &left, Utf8String const &right)
+    {
+        // Copies of the same string, interned ones in particular, share their data.
+        return (left.m_data == right.m_data) || left.Compare(right) == 0;
+    }
+
     friend bool operator==(Utf8String const &left, const char *right) { return left.Compare(right) == 0; }
     friend bool operator==(const char *left, Utf8String const &right) { return right.Compare(left) == 0; }
-    friend bool operator!=(Utf8String const &left, Utf8String const &right) { return left.Compare(right) != 0; }
+    friend bool operator!=(Utf8String const &left, Utf8String const &right)
+    {
+        return (left.m_data != right.m_data) && left.Compare(right) != 0;
+    }
+
     friend bool operator!=(Utf8String const &left, const char *right) { return left.Compare(right) != 0; }
     friend bool operator!=(const char *left, Utf8String const &right) { return right.Compare(left) != 0; }
     friend bool operator<(Utf8String const &left, Utf8String const &right) { return left.Compare(right) < 0; }
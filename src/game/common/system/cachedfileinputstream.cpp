@@ -14,14 +14,69 @@
  */
 #include "cachedfileinputstream.h"
 #include "compressionmanager.h"
+#include "decompressionstream.h"
 #include "filesystem.h"
 #include <algorithm>
+#include <cstring>
 
-CachedFileInputStream::~CachedFileInputStream()
+using std::memmove;
+
+namespace
 {
-    if (m_cachedData != nullptr) {
-        delete[] m_cachedData;
+enum
+{
+    INPUT_SIZE = 64 * 1024,
+};
+
+/**
+ * Decompresses a file as it is read so the compressed data is never held in memory as a whole.
+ */
+uint8_t *Read_Decompressed(File *file, const uint8_t *header, unsigned &size)
+{
+    DecompressionStream decoder;
+
+    if (!decoder.Begin(header, DecompressionStream::HEADER_SIZE)) {
+        return nullptr;
+    }
+
+    int out_size = decoder.Get_Uncompressed_Size();
+    uint8_t *data = new uint8_t[out_size > 0 ? out_size : 1];
+    uint8_t *input = new uint8_t[INPUT_SIZE];
+    int input_size = 0;
+    int written = 0;
+    bool ok = true;
+
+    while (ok && !decoder.Finished()) {
+        int read = file->Read(input + input_size, INPUT_SIZE - input_size);
+        input_size += read > 0 ? read : 0;
+
+        int src_used;
+        int dst_used;
+        ok = decoder.Decode(input, input_size, &src_used, data + written, written, out_size - written, &dst_used);
+        written += dst_used;
+
+        // No progress with nothing left to read means the file is truncated.
+        ok = ok && (read > 0 || src_used > 0 || dst_used > 0 || decoder.Finished());
+        memmove(input, input + src_used, input_size - src_used);
+        input_size -= src_used;
     }
+
+    delete[] input;
+
+    if (!ok || written != out_size) {
+        delete[] data;
+        return nullptr;
+    }
+
+    size = out_size;
+
+    return data;
+}
+} // namespace
+
+CachedFileInputStream::~CachedFileInputStream()
+{
+    Close();
 }
 
 /**
@@ -80,13 +135,57 @@ bool CachedFileInputStream::Eof()
  */
 bool CachedFileInputStream::Open(Utf8String filename)
 {
+    Close();
     File *file = g_theFileSystem->Open(filename, File::BINARY | File::READ);
-    m_cachedSize = 0;
+    bool decompressed = false;
 
     if (file != nullptr) {
+        uint8_t header[DecompressionStream::HEADER_SIZE];
         m_cachedSize = file->Size();
 
-        if (m_cachedSize > 0) {
+#ifndef GAME_DLL
+        // Files already in memory are decoded straight from it, or read in place if they aren't compressed.
+        const uint8_t *view = static_cast<const uint8_t *>(file->Peek_Data());
+
+        if (view != nullptr && m_cachedSize > 0) {
+            if (!CompressionManager::Is_Data_Compressed(view, m_cachedSize)) {
+                m_cachedData = view;
+                m_viewFile = file;
+                m_cachePos = 0;
+
+                return true;
+            }
+
+            int decomp_size = CompressionManager::Get_Uncompressed_Size(view, m_cachedSize);
+            uint8_t *decomp_data = new uint8_t[decomp_size > 0 ? decomp_size : 1];
+
+            if (CompressionManager::Decompress_Data(
+                    const_cast<uint8_t *>(view), m_cachedSize, decomp_data, decomp_size) == decomp_size) {
+                file->Close();
+                m_cachedData = decomp_data;
+                m_cachedSize = decomp_size;
+                m_cachePos = 0;
+
+                return m_cachedSize > 0;
+            }
+
+            delete[] decomp_data;
+        }
+#endif
+
+        // RefPack and zlib files are decoded while they are read, anything else is read whole and decoded below.
+        if (file->Read(header, sizeof(header)) == sizeof(header)
+            && DecompressionStream::Can_Stream(CompressionManager::Get_Compression_Type(header, sizeof(header)))) {
+            uint8_t *data = Read_Decompressed(file, header, m_cachedSize);
+
+            if (data != nullptr) {
+                m_cachedData = data;
+                decompressed = true;
+            }
+        }
+
+        if (!decompressed && m_cachedSize > 0) {
+            file->Seek(0, File::START);
             m_cachedData = static_cast<uint8_t *>(file->Read_All_And_Close());
             file = nullptr;
         }
@@ -95,11 +194,12 @@ bool CachedFileInputStream::Open(Utf8String filename)
     }
 
     // Handle compressed data.
-    if (CompressionManager::Is_Data_Compressed(m_cachedData, m_cachedSize)) {
+    if (!decompressed && CompressionManager::Is_Data_Compressed(m_cachedData, m_cachedSize)) {
         int decomp_size = CompressionManager::Get_Uncompressed_Size(m_cachedData, m_cachedSize);
         uint8_t *decomp_data = new uint8_t[decomp_size];
 
-        if (CompressionManager::Decompress_Data(m_cachedData, m_cachedSize, decomp_data, decomp_size) == decomp_size) {
+        if (CompressionManager::Decompress_Data(const_cast<uint8_t *>(m_cachedData), m_cachedSize, decomp_data, decomp_size)
+            == decomp_size) {
             delete[] m_cachedData;
             m_cachedData = decomp_data;
             m_cachedSize = decomp_size;
@@ -120,11 +220,15 @@ bool CachedFileInputStream::Open(Utf8String filename)
  */
 void CachedFileInputStream::Close()
 {
-    if (m_cachedData) {
+    if (m_viewFile != nullptr) {
+        m_viewFile->Close();
+        m_viewFile = nullptr;
+    } else if (m_cachedData != nullptr) {
         delete[] m_cachedData;
-        m_cachedData = nullptr;
     }
 
+    m_cachedData = nullptr;
+
     m_cachePos = 0;
     m_cachedSize = 0;
 }
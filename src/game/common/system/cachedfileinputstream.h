@@ -18,6 +18,8 @@
 #include "asciistring.h"
 #include "chunkinputstream.h"
 
+class File;
+
 #ifdef GAME_DLL
 #include "hooker.h"
 #endif
@@ -25,7 +27,7 @@
 class CachedFileInputStream : public ChunkInputStream
 {
 public:
-    CachedFileInputStream() : m_cachedSize(0), m_cachedData(nullptr), m_cachePos(0) {}
+    CachedFileInputStream() : m_cachedSize(0), m_cachedData(nullptr), m_cachePos(0), m_viewFile(nullptr) {}
     ~CachedFileInputStream();
 
     virtual int Read(void *dst, int size) override;
@@ -39,6 +41,7 @@ public:
 
 private:
     unsigned m_cachedSize;
-    uint8_t *m_cachedData;
+    const uint8_t *m_cachedData;
     unsigned m_cachePos;
+    File *m_viewFile; // Set when m_cachedData is borrowed from a file held in memory.
 };
\ No newline at end of file
@@ -0,0 +1,93 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Helpers for reading and writing the binary caches the engine keeps between launches.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include <cstring>
+#include <vector>
+
+namespace rts
+{
+// Everything in a cache is kept four byte aligned so tables can be used in place.
+inline uint32_t Cache_Pad_Size(uint32_t size)
+{
+    return (size + 3) & ~3u;
+}
+
+/**
+ * @brief Hands out pieces of a cache buffer, failing once anything would run past the end.
+ */
+class CacheReader
+{
+public:
+    CacheReader(const uint8_t *data, uint32_t size) : m_data(data), m_size(size), m_pos(0) {}
+
+    const uint8_t *Get(uint32_t size)
+    {
+        if (size > m_size - m_pos) {
+            return nullptr;
+        }
+
+        const uint8_t *data = m_data + m_pos;
+        m_pos += size;
+
+        return data;
+    }
+
+    bool Get_Int(uint32_t &value)
+    {
+        const uint8_t *data = Get(sizeof(value));
+
+        if (data == nullptr) {
+            return false;
+        }
+
+        std::memcpy(&value, data, sizeof(value));
+
+        return true;
+    }
+
+private:
+    const uint8_t *m_data;
+    uint32_t m_size;
+    uint32_t m_pos;
+};
+
+inline void Cache_Put_Data(std::vector<uint8_t> &buffer, const void *data, uint32_t size)
+{
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+inline void Cache_Put_Int(std::vector<uint8_t> &buffer, uint32_t value)
+{
+    Cache_Put_Data(buffer, &value, sizeof(value));
+}
+
+// Writes a nul terminated string padded out to keep the buffer aligned, preceded by its padded size.
+inline void Cache_Put_String(std::vector<uint8_t> &buffer, const char *string, uint32_t length)
+{
+    static const char padding[4] = {};
+    Cache_Put_Int(buffer, Cache_Pad_Size(length + 1));
+    Cache_Put_Data(buffer, string, length + 1);
+    Cache_Put_Data(buffer, padding, Cache_Pad_Size(length + 1) - (length + 1));
+}
+
+inline void Cache_Put_Padding(std::vector<uint8_t> &buffer)
+{
+    static const char padding[4] = {};
+    Cache_Put_Data(buffer, padding, Cache_Pad_Size(uint32_t(buffer.size())) - uint32_t(buffer.size()));
+}
+} // namespace rts
@@ -66,6 +66,10 @@ public:
 
     virtual void *Read_All_And_Close() = 0;
     virtual File *Convert_To_RAM() = 0;
+#ifndef GAME_DLL
+    // Files already held in memory can lend out their contents until they are closed instead of copying them.
+    virtual const void *Peek_Data() { return nullptr; }
+#endif
 
     Utf8String &Get_File_Name() { return m_filename; }
     int Get_File_Mode() { return m_openMode; }
@@ -0,0 +1,355 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Reads files ahead of time on an I/O thread so opening them later doesn't wait on the disk.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "fileprefetcher.h"
+
+#ifndef GAME_DLL
+#include "archivefilesystem.h"
+#include "file.h"
+#include "localfilesystem.h"
+#include "ramfile.h"
+#include <algorithm>
+#include <captainslog.h>
+
+struct PrefetchRequest
+{
+    enum State
+    {
+        QUEUED,
+        READING,
+        DONE,
+    };
+
+    Utf8String path;
+    Utf8String key;
+    State state;
+    bool succeeded;
+    bool discard; // Set when the request is dropped while it is being read.
+    char *data;
+    int size;
+};
+
+namespace
+{
+Utf8String Normalise_Path(const char *filename)
+{
+    Utf8String key = Utf8String(filename).Posix_Path();
+    key.To_Lower();
+
+    return key;
+}
+} // namespace
+
+/**
+ * @brief Check if the file has been read or failed to be.
+ */
+bool PrefetchHandle::Is_Ready() const
+{
+    if (m_request == nullptr) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_prefetcher->m_mutex);
+
+    return m_request->state == PrefetchRequest::DONE;
+}
+
+/**
+ * @brief Block until the file has been read, returns false if it couldn't be.
+ */
+bool PrefetchHandle::Wait() const
+{
+    if (m_request == nullptr) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(m_prefetcher->m_mutex);
+    m_prefetcher->m_finished.wait(lock, [this]() { return m_request->state == PrefetchRequest::DONE; });
+
+    return m_request->succeeded;
+}
+
+FilePrefetcher::FilePrefetcher() :
+    m_stop(false), m_reading(false), m_cachedBytes(0), m_requestCount(0), m_archive(nullptr)
+{
+}
+
+FilePrefetcher::~FilePrefetcher()
+{
+    Clear();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_queued.notify_all();
+
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+/**
+ * @brief Queue a file to be read, asking for a file that is already queued or cached returns the same request.
+ */
+PrefetchHandle FilePrefetcher::Prefetch(const char *filename)
+{
+    PrefetchHandle handle;
+    handle.m_prefetcher = this;
+    Utf8String key = Normalise_Path(filename);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::shared_ptr<PrefetchRequest> &request = m_requests[key];
+
+    if (request == nullptr) {
+        request = std::make_shared<PrefetchRequest>();
+        request->path = filename;
+        request->key = key;
+        request->state = PrefetchRequest::QUEUED;
+        request->succeeded = false;
+        request->discard = false;
+        request->data = nullptr;
+        request->size = 0;
+        m_queue.push_back(request);
+        Update_Request_Count();
+
+        // The I/O thread is only started once something is prefetched.
+        if (!m_thread.joinable()) {
+            m_thread = std::thread(&FilePrefetcher::Worker, this);
+        }
+
+        m_queued.notify_one();
+    }
+
+    handle.m_request = request;
+
+    return handle;
+}
+
+/**
+ * @brief Open a file from the cache, returns nullptr if it wasn't prefetched so it has to be opened the usual way.
+ */
+File *FilePrefetcher::Open(const char *filename, int mode)
+{
+    if (m_requestCount.load(std::memory_order_acquire) == 0) {
+        return nullptr;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto it = m_requests.find(Normalise_Path(filename));
+
+    if (it == m_requests.end()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<PrefetchRequest> request = it->second;
+
+    // Cached data is binary and only good for reading, a request that hasn't started yet isn't worth waiting for.
+    if ((mode & (File::WRITE | File::TEXT)) != 0 || request->state == PrefetchRequest::QUEUED) {
+        Remove(request);
+        return nullptr;
+    }
+
+    m_finished.wait(lock, [&request]() { return request->state == PrefetchRequest::DONE; });
+
+    char *data = request->data;
+    int size = request->size;
+
+    if (data != nullptr) {
+        m_cachedBytes -= size;
+        request->data = nullptr;
+    }
+
+    Remove(request);
+    lock.unlock();
+
+    if (data == nullptr) {
+        return nullptr;
+    }
+
+    RAMFile *file = new RAMFile;
+    file->Set_Del_On_Close(true);
+
+    if (!file->Open_Buffer(filename, data, size)) {
+        delete[] data;
+        file->Close();
+
+        return nullptr;
+    }
+
+    return file;
+}
+
+/**
+ * @brief Drop everything that is queued or cached, waits for a file being read to finish.
+ */
+void FilePrefetcher::Clear()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (!m_requests.empty()) {
+        std::shared_ptr<PrefetchRequest> request = m_requests.begin()->second;
+        Remove(request);
+    }
+
+    m_queue.clear();
+    m_cached.clear();
+    m_cachedBytes = 0;
+    m_finished.wait(lock, [this]() { return !m_reading; });
+}
+
+void FilePrefetcher::Worker()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true) {
+        m_queued.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+
+        if (m_stop) {
+            break;
+        }
+
+        std::shared_ptr<PrefetchRequest> request = m_queue.front();
+        m_queue.pop_front();
+
+        // Requests dropped before they were read are already done.
+        if (request->state != PrefetchRequest::QUEUED) {
+            continue;
+        }
+
+        request->state = PrefetchRequest::READING;
+        m_reading = true;
+        lock.unlock();
+
+        bool succeeded = Read_File(*request);
+
+        lock.lock();
+        m_reading = false;
+        request->state = PrefetchRequest::DONE;
+        request->succeeded = succeeded;
+
+        // Files too big for the cache still leave the OS cache warm.
+        if (request->discard || !succeeded || request->size > CACHE_SIZE) {
+            delete[] request->data;
+            request->data = nullptr;
+            Remove(request);
+        } else {
+            m_cached.push_back(request);
+            m_cachedBytes += request->size;
+
+            while (m_cachedBytes > CACHE_SIZE) {
+                std::shared_ptr<PrefetchRequest> oldest = m_cached.front();
+                captainslog_debug("Prefetch cache is full, dropping '%s'.", oldest->path.Str());
+                Remove(oldest);
+            }
+        }
+
+        m_finished.notify_all();
+    }
+
+    lock.unlock();
+
+    if (m_archive != nullptr) {
+        m_archive->Close();
+        m_archive = nullptr;
+    }
+}
+
+/**
+ * @brief Read a whole file into the request, runs on the I/O thread without the lock held.
+ */
+bool FilePrefetcher::Read_File(PrefetchRequest &request)
+{
+    // Local files take priority over archived ones just like they do in FileSystem::Open.
+    File *file = g_theLocalFileSystem->Open_File(request.path.Str(), File::READ | File::BINARY);
+    int position = 0;
+
+    if (file != nullptr) {
+        request.size = file->Size();
+    } else {
+        Utf8String archive;
+
+        if (g_theArchiveFileSystem == nullptr
+            || !g_theArchiveFileSystem->Get_Archived_File_Location(request.path.Str(), archive, position, request.size)) {
+            return false;
+        }
+
+        // Handles to archives held by the archive file system can't be shared with another thread.
+        if (m_archive == nullptr || m_archiveName != archive) {
+            if (m_archive != nullptr) {
+                m_archive->Close();
+            }
+
+            m_archive = g_theLocalFileSystem->Open_File(archive.Str(), File::READ | File::BINARY);
+            m_archiveName = archive;
+
+            if (m_archive == nullptr) {
+                return false;
+            }
+        }
+    }
+
+    File *source = file != nullptr ? file : m_archive;
+    request.data = new char[request.size > 0 ? request.size : 1];
+    bool succeeded = request.size >= 0 && (file != nullptr || source->Seek(position, File::START) == position)
+        && source->Read(request.data, request.size) == request.size;
+
+    if (file != nullptr) {
+        file->Close();
+    }
+
+    return succeeded;
+}
+
+/**
+ * @brief Forget about a request, must be called with the lock held.
+ */
+void FilePrefetcher::Remove(std::shared_ptr<PrefetchRequest> const &request)
+{
+    auto it = m_requests.find(request->key);
+
+    if (it != m_requests.end() && it->second == request) {
+        m_requests.erase(it);
+        Update_Request_Count();
+    }
+
+    switch (request->state) {
+        case PrefetchRequest::QUEUED:
+            request->state = PrefetchRequest::DONE;
+            request->succeeded = false;
+            m_finished.notify_all();
+            break;
+        case PrefetchRequest::READING:
+            request->discard = true;
+            break;
+        case PrefetchRequest::DONE: {
+            if (request->data != nullptr) {
+                m_cachedBytes -= request->size;
+                delete[] request->data;
+                request->data = nullptr;
+            }
+
+            // Opened requests have already given up their data but are still waiting to be evicted.
+            auto cached = std::find(m_cached.begin(), m_cached.end(), request);
+
+            if (cached != m_cached.end()) {
+                m_cached.erase(cached);
+            }
+
+            break;
+        }
+    }
+}
+#endif
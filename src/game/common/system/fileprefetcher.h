@@ -0,0 +1,99 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Reads files ahead of time on an I/O thread so opening them later doesn't wait on the disk.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "asciistring.h"
+
+// Relies on standard threads which the original binary has no equivalent of.
+#ifndef GAME_DLL
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class File;
+class FilePrefetcher;
+struct PrefetchRequest;
+
+/**
+ * @brief Future like handle to a file queued for prefetching.
+ */
+class PrefetchHandle
+{
+    friend class FilePrefetcher;
+
+public:
+    PrefetchHandle() : m_prefetcher(nullptr) {}
+
+    bool Is_Valid() const { return m_request != nullptr; }
+    bool Is_Ready() const;
+    bool Wait() const;
+
+private:
+    FilePrefetcher *m_prefetcher;
+    std::shared_ptr<PrefetchRequest> m_request;
+};
+
+/**
+ * Queue of files to read on a dedicated I/O thread into a cache bounded by CACHE_SIZE, opening a file that has been
+ * read hands its data over without another read. Files are looked up the same way FileSystem::Open does, local files
+ * first, archived files are read through a handle of the I/O thread's own. The oldest cached files are dropped first
+ * when the cache fills up. Archives must not be loaded or closed while files are being prefetched.
+ */
+class FilePrefetcher
+{
+    friend class PrefetchHandle;
+
+    enum
+    {
+        CACHE_SIZE = 64 * 1024 * 1024,
+    };
+
+public:
+    FilePrefetcher();
+    ~FilePrefetcher();
+
+    PrefetchHandle Prefetch(const char *filename);
+    File *Open(const char *filename, int mode);
+    void Clear();
+
+private:
+    void Worker();
+    bool Read_File(PrefetchRequest &request);
+    void Remove(std::shared_ptr<PrefetchRequest> const &request);
+    void Update_Request_Count() { m_requestCount.store(int(m_requests.size()), std::memory_order_release); }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_queued;
+    std::condition_variable m_finished;
+    std::thread m_thread;
+    bool m_stop;
+    bool m_reading;
+    std::deque<std::shared_ptr<PrefetchRequest>> m_queue;
+    std::map<Utf8String, std::shared_ptr<PrefetchRequest>> m_requests; // Keyed by normalised path.
+    std::deque<std::shared_ptr<PrefetchRequest>> m_cached; // Oldest first.
+    int m_cachedBytes;
+    std::atomic<int> m_requestCount; // Lets Open skip the lock when nothing is prefetched.
+
+    // Only used by the I/O thread.
+    File *m_archive;
+    Utf8String m_archiveName;
+};
+#endif
@@ -19,6 +19,14 @@
 
 #ifndef GAME_DLL
 FileSystem *g_theFileSystem = nullptr;
+
+namespace
+{
+enum
+{
+    EXIST_POLL_INTERVAL = 256, // Lookups between checks for local file changes, must be a power of two.
+};
+} // namespace
 #endif
 
 void FileSystem::Init()
@@ -29,6 +37,10 @@ void FileSystem::Init()
 
 void FileSystem::Reset()
 {
+#ifndef GAME_DLL
+    m_prefetcher.Clear();
+#endif
+
     g_theLocalFileSystem->Reset();
     g_theArchiveFileSystem->Reset();
 }
@@ -43,6 +55,14 @@ File *FileSystem::Open(const char *filename, int mode)
 {
     File *file = nullptr;
 
+#ifndef GAME_DLL
+    file = m_prefetcher.Open(filename, mode);
+
+    if (file != nullptr) {
+        return file;
+    }
+#endif
+
     if (g_theLocalFileSystem != nullptr) {
         file = g_theLocalFileSystem->Open_File(filename, mode);
     }
@@ -56,14 +76,39 @@ File *FileSystem::Open(const char *filename, int mode)
 
 bool FileSystem::Does_File_Exist(const char *filename)
 {
+#ifndef GAME_DLL
+    // Both hits and misses are cached, so they are dropped once files are added or removed anywhere. Change
+    // notifications are drained each Update, and every so often here too so long runs of lookups between updates
+    // don't keep answering from a stale cache.
+    if (((m_existHits + m_existMisses) & (EXIST_POLL_INTERVAL - 1)) == EXIST_POLL_INTERVAL - 1) {
+        g_theLocalFileSystem->Update();
+    }
+
+    unsigned local_generation = g_theLocalFileSystem->Get_Generation();
+    unsigned archive_generation = g_theArchiveFileSystem->Get_Generation();
+
+    if (local_generation != m_localGeneration || archive_generation != m_archiveGeneration) {
+        m_availableFiles.clear();
+        m_localGeneration = local_generation;
+        m_archiveGeneration = archive_generation;
+    }
+#endif
+
     NameKeyType name_id = g_theNameKeyGenerator->Name_To_Lower_Case_Key(filename);
 
     auto it = m_availableFiles.find(name_id);
 
     if (it != m_availableFiles.end()) {
+#ifndef GAME_DLL
+        ++m_existHits;
+#endif
         return it->second;
     }
 
+#ifndef GAME_DLL
+    ++m_existMisses;
+#endif
+
     if (g_theLocalFileSystem->Does_File_Exist(filename)) {
         m_availableFiles[name_id] = true;
 
@@ -88,6 +133,34 @@ void FileSystem::Get_File_List_From_Dir(Utf8String const &dir, Utf8String const
     g_theArchiveFileSystem->Get_File_List_From_Dir("", dir, filter, filelist, search_subdirs);
 }
 
+#ifndef GAME_DLL
+/**
+ * @brief Queue a file to be read on the I/O thread, opening it later takes the data without waiting on the disk.
+ */
+PrefetchHandle FileSystem::Prefetch(const char *filename)
+{
+    return m_prefetcher.Prefetch(filename);
+}
+
+/**
+ * @brief Queue a list of files, for example everything a map is about to load.
+ */
+void FileSystem::Prefetch(std::vector<Utf8String> const &filenames)
+{
+    for (auto it = filenames.begin(); it != filenames.end(); ++it) {
+        m_prefetcher.Prefetch(it->Str());
+    }
+}
+
+/**
+ * @brief Open a file only if it has been prefetched, unlike Open this is safe to call from any thread.
+ */
+File *FileSystem::Open_Prefetched(const char *filename)
+{
+    return m_prefetcher.Open(filename, File::READ | File::BINARY);
+}
+#endif
+
 bool FileSystem::Create_Dir(Utf8String name)
 {
     if (g_theLocalFileSystem == nullptr) {
@@ -15,15 +15,21 @@
 #pragma once
 
 #include "file.h"
+#include "fileprefetcher.h"
 #include "rtsutils.h"
 #include "subsysteminterface.h"
 #include <map>
 #include <set>
+#include <vector>
 
 class FileSystem : public SubsystemInterface
 {
 public:
+#ifdef GAME_DLL
     FileSystem() : m_availableFiles() {}
+#else
+    FileSystem() : m_availableFiles(), m_localGeneration(0), m_archiveGeneration(0), m_existHits(0), m_existMisses(0) {}
+#endif
     virtual ~FileSystem() {}
 
     // SubsystemInterface implementations
@@ -37,6 +43,14 @@ public:
     void Get_File_List_From_Dir(Utf8String const &dir, Utf8String const &filter,
         std::set<Utf8String, rts::less_than_nocase<Utf8String>> &filelist, bool a5);
 
+#ifndef GAME_DLL
+    PrefetchHandle Prefetch(const char *filename);
+    void Prefetch(std::vector<Utf8String> const &filenames);
+    File *Open_Prefetched(const char *filename);
+    int Get_Exist_Cache_Hits() const { return m_existHits; }
+    int Get_Exist_Cache_Misses() const { return m_existMisses; }
+#endif
+
     static bool Create_Dir(Utf8String name);
     static bool Are_Music_Files_On_CD();
     static bool Load_Music_Files_From_CD();
@@ -44,6 +58,13 @@ public:
 
 private:
     std::map<unsigned int, bool> m_availableFiles;
+#ifndef GAME_DLL
+    FilePrefetcher m_prefetcher;
+    unsigned m_localGeneration; // Generations of the file systems when m_availableFiles was last valid.
+    unsigned m_archiveGeneration;
+    int m_existHits;
+    int m_existMisses;
+#endif
 };
 
 #ifdef GAME_DLL
@@ -0,0 +1,172 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Linear allocator for memory that only needs to live until the end of the current frame.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "framearena.h"
+
+#ifndef GAME_DLL
+#include "rawalloc.h"
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+struct FrameArenaChunk
+{
+    FrameArenaChunk *next;
+    char *data; // Aligned start of the usable space following the header.
+    int size;
+    int used;
+};
+
+/**
+ * @brief Chunks owned by a single thread, freed when the thread exits.
+ */
+class FrameArenaThreadState
+{
+public:
+    FrameArenaThreadState() : m_first(nullptr), m_last(nullptr), m_current(nullptr), m_frame(0), m_used(0), m_reserved(0)
+    {
+    }
+
+    ~FrameArenaThreadState();
+
+    void *Allocate(int bytes, unsigned frame);
+    int Get_Used(unsigned frame) const { return m_frame == frame ? m_used : 0; }
+    int Get_Reserved() const { return m_reserved; }
+
+private:
+    void Rewind(unsigned frame);
+    FrameArenaChunk *Add_Chunk(int bytes);
+
+private:
+    FrameArenaChunk *m_first;
+    FrameArenaChunk *m_last;
+    FrameArenaChunk *m_current;
+    unsigned m_frame;
+    int m_used;
+    int m_reserved;
+};
+
+std::atomic<unsigned> s_frameArenaFrame(0);
+thread_local FrameArenaThreadState s_frameArenaState;
+} // namespace
+
+FrameArenaThreadState::~FrameArenaThreadState()
+{
+    for (FrameArenaChunk *chunk = m_first; chunk != nullptr;) {
+        FrameArenaChunk *next = chunk->next;
+        Raw_Free(chunk);
+        chunk = next;
+    }
+
+    m_first = nullptr;
+    m_last = nullptr;
+    m_current = nullptr;
+}
+
+void *FrameArenaThreadState::Allocate(int bytes, unsigned frame)
+{
+    if (m_frame != frame) {
+        Rewind(frame);
+    }
+
+    int size = (std::max(bytes, 1) + FrameArena::ALIGNMENT - 1) & ~(FrameArena::ALIGNMENT - 1);
+
+    // Chunks are kept between frames so after the first few frames this rarely has to allocate.
+    while (m_current != nullptr && m_current->used + size > m_current->size) {
+        m_current = m_current->next;
+    }
+
+    if (m_current == nullptr) {
+        m_current = Add_Chunk(size);
+    }
+
+    void *block = m_current->data + m_current->used;
+    m_current->used += size;
+    m_used += size;
+
+    return block;
+}
+
+void FrameArenaThreadState::Rewind(unsigned frame)
+{
+    for (FrameArenaChunk *chunk = m_first; chunk != nullptr; chunk = chunk->next) {
+        chunk->used = 0;
+    }
+
+    m_current = m_first;
+    m_frame = frame;
+    m_used = 0;
+}
+
+FrameArenaChunk *FrameArenaThreadState::Add_Chunk(int bytes)
+{
+    int size = std::max(int(FrameArena::CHUNK_SIZE), bytes);
+    char *memory = static_cast<char *>(Raw_Allocate_No_Zero(sizeof(FrameArenaChunk) + FrameArena::ALIGNMENT + size));
+    FrameArenaChunk *chunk = reinterpret_cast<FrameArenaChunk *>(memory);
+    uintptr_t data = reinterpret_cast<uintptr_t>(memory + sizeof(FrameArenaChunk));
+    chunk->data = reinterpret_cast<char *>((data + FrameArena::ALIGNMENT - 1) & ~uintptr_t(FrameArena::ALIGNMENT - 1));
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->next = nullptr;
+
+    if (m_last != nullptr) {
+        m_last->next = chunk;
+    } else {
+        m_first = chunk;
+    }
+
+    m_last = chunk;
+    m_reserved += size;
+
+    return chunk;
+}
+
+/**
+ * @brief Allocates memory that remains valid until the next End_Frame call, it must not be freed.
+ */
+void *FrameArena::Allocate(int bytes)
+{
+    return s_frameArenaState.Allocate(bytes, s_frameArenaFrame.load(std::memory_order_acquire));
+}
+
+/**
+ * @brief Invalidates everything allocated from the arena by any thread during the current frame.
+ */
+void FrameArena::End_Frame()
+{
+    s_frameArenaFrame.fetch_add(1, std::memory_order_release);
+}
+
+unsigned FrameArena::Get_Frame()
+{
+    return s_frameArenaFrame.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Gets how much the calling thread has allocated from the arena in the current frame.
+ */
+int FrameArena::Get_Thread_Bytes_Used()
+{
+    return s_frameArenaState.Get_Used(s_frameArenaFrame.load(std::memory_order_acquire));
+}
+
+/**
+ * @brief Gets how much memory the calling thread is holding in arena chunks.
+ */
+int FrameArena::Get_Thread_Bytes_Reserved()
+{
+    return s_frameArenaState.Get_Reserved();
+}
+#endif
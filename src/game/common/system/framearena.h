@@ -0,0 +1,43 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Linear allocator for memory that only needs to live until the end of the current frame.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+
+// Relies on C++11 thread_local and atomics which the STLPort based hooked build can't provide.
+#ifndef GAME_DLL
+/**
+ * @brief Bump allocator reset in one go at the end of every GameEngine update.
+ *
+ * Each thread allocates from its own list of chunks so allocation never takes a lock. End_Frame only advances a
+ * frame counter, each thread rewinds its chunks the next time it allocates after that. Memory handed out is only
+ * valid until the next End_Frame call so anything that can survive a frame must not use it, worker threads included.
+ */
+class FrameArena
+{
+public:
+    enum
+    {
+        CHUNK_SIZE = 64 * 1024,
+        ALIGNMENT = 16,
+    };
+
+    static void *Allocate(int bytes);
+    static void End_Frame();
+    static unsigned Get_Frame();
+    static int Get_Thread_Bytes_Used();
+    static int Get_Thread_Bytes_Reserved();
+};
+#endif
@@ -20,10 +20,30 @@
 #include "memdynalloc.h"
 #include "mempool.h"
 #include "mempoolfact.h"
+#include "mempooltrim.h"
+#include "memtrace.h"
+#include <cstdlib>
+
+using std::getenv;
 
 #ifndef GAME_DLL
 bool g_thePreMainInitFlag = false;
 bool g_theMainInitFlag = false;
+
+namespace
+{
+/**
+ * @brief Starts an allocation trace if THYME_MEMORY_TRACE names a file to write it to.
+ */
+void Start_Memory_Trace()
+{
+    const char *trace_file = getenv("THYME_MEMORY_TRACE");
+
+    if (trace_file != nullptr && *trace_file != '\0') {
+        MemoryTrace::Start(trace_file);
+    }
+}
+} // namespace
 #else 
 #include "hooker.h"
 #endif
@@ -54,12 +74,16 @@ void Init_Memory_Manager()
 
     if (g_memoryPoolFactory == nullptr) {
         captainslog_trace("Memory Manager initialising normally.\n");
+        User_Memory_Load_Profile();
         User_Memory_Get_DMA_Params(&param_count, &params);
         g_memoryPoolFactory = new MemoryPoolFactory;
         g_memoryPoolFactory->Init();
         g_dynamicMemoryAllocator = g_memoryPoolFactory->Create_Dynamic_Memory_Allocator(param_count, params);
         User_Memory_Init_Pools();
         g_thePreMainInitFlag = false;
+#ifndef GAME_DLL
+        Start_Memory_Trace();
+#endif
     }
 
     // Check that new and delete both use our custom implementation.
@@ -79,6 +103,13 @@ void Init_Memory_Manager()
         exit(-1);
     }
 
+#ifndef GAME_DLL
+    if (g_thePoolTrimThread == nullptr) {
+        g_thePoolTrimThread = new PoolTrimThreadClass;
+        g_thePoolTrimThread->Execute();
+    }
+#endif
+
     g_theMainInitFlag = true;
 }
 
@@ -90,19 +121,46 @@ void Init_Memory_Manager_Pre_Main()
     if (g_memoryPoolFactory == nullptr) {
         captainslog_trace("Memory Manager initialising prior to WinMain\n");
 
+        User_Memory_Load_Profile();
         User_Memory_Get_DMA_Params(&param_count, &params);
         g_memoryPoolFactory = new MemoryPoolFactory;
         g_memoryPoolFactory->Init();
         g_dynamicMemoryAllocator = g_memoryPoolFactory->Create_Dynamic_Memory_Allocator(param_count, params);
         User_Memory_Init_Pools();
         g_thePreMainInitFlag = true;
+#ifndef GAME_DLL
+        Start_Memory_Trace();
+#endif
     }
 }
 
 void Shutdown_Memory_Manager()
 {
+#ifndef GAME_DLL
+    MemoryTrace::Stop();
+
+    if (g_thePoolTrimThread != nullptr) {
+        g_thePoolTrimThread->Stop(3000);
+        delete g_thePoolTrimThread;
+        g_thePoolTrimThread = nullptr;
+    }
+#endif
+
+    // Pre main initialised managers are never torn down, but their usage is still worth recording.
+    if (g_memoryPoolFactory != nullptr) {
+        g_memoryPoolFactory->Record_Pool_Profile();
+    }
+
     if (!g_thePreMainInitFlag) {
         if (g_memoryPoolFactory != nullptr) {
+#ifndef GAME_DLL
+            g_memoryPoolFactory->Debug_Contention_Report();
+
+            if (g_dynamicMemoryAllocator != nullptr) {
+                g_dynamicMemoryAllocator->Debug_Size_Class_Report();
+            }
+#endif
+
             if (g_dynamicMemoryAllocator != nullptr) {
                 g_memoryPoolFactory->Destroy_Dynamic_Memory_Allocator(g_dynamicMemoryAllocator);
                 g_dynamicMemoryAllocator = nullptr;
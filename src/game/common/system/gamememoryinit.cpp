@@ -15,18 +15,20 @@
 #include "gamememoryinit.h"
 #include "rawalloc.h"
 #include <algorithm>
+#include <captainslog.h>
 #include <cstdio>
 #include <cstring>
 
 #ifndef PLATFORM_WINDOWS
-#include <libgen.h>
 #include <unistd.h>
 #endif
 
+using std::memcpy;
 using std::strcat;
 using std::strcmp;
 using std::strlen;
 
+#ifdef GAME_DLL
 static PoolInitRec const UserDMAParameters[7] = {
     {"dmaPool_16", 16, 130000, 10000},
     {"dmaPool_32", 32, 250000, 10000},
@@ -36,6 +38,34 @@ static PoolInitRec const UserDMAParameters[7] = {
     {"dmaPool_512", 512, 16000, 5000},
     {"dmaPool_1024", 1024, 6000, 1024},
 };
+#else
+// Standalone uses half power of two spacing up to 32KB so medium sized strings, dicts and chunk buffers are pooled
+// too. Counts for the classes the original table already had are split between the two classes now covering them.
+static PoolInitRec const UserDMAParameters[] = {
+    {"dmaPool_16", 16, 130000, 10000},
+    {"dmaPool_32", 32, 250000, 10000},
+    {"dmaPool_48", 48, 50000, 5000},
+    {"dmaPool_64", 64, 50000, 5000},
+    {"dmaPool_96", 96, 40000, 5000},
+    {"dmaPool_128", 128, 40000, 5000},
+    {"dmaPool_192", 192, 10000, 2500},
+    {"dmaPool_256", 256, 10000, 2500},
+    {"dmaPool_384", 384, 8000, 2500},
+    {"dmaPool_512", 512, 8000, 2500},
+    {"dmaPool_768", 768, 3000, 512},
+    {"dmaPool_1024", 1024, 3000, 512},
+    {"dmaPool_1536", 1536, 256, 64},
+    {"dmaPool_2048", 2048, 256, 64},
+    {"dmaPool_3072", 3072, 128, 32},
+    {"dmaPool_4096", 4096, 128, 32},
+    {"dmaPool_6144", 6144, 64, 16},
+    {"dmaPool_8192", 8192, 64, 16},
+    {"dmaPool_12288", 12288, 32, 8},
+    {"dmaPool_16384", 16384, 32, 8},
+    {"dmaPool_24576", 24576, 16, 8},
+    {"dmaPool_32768", 32768, 16, 8},
+};
+#endif
 
 static PoolSizeRec UserMemoryPools[] = {
     {"PartitionContactListNode", 2048, 512},
@@ -490,6 +520,7 @@ static PoolSizeRec UserMemoryPools[] = {
     {"SequentialScript", 32, 32},
     {"Win32LocalFile", 1024, 256},
     {"RAMFile", 32, 32},
+    {"MappedArchiveFile", 32, 32},
     {"BattlePlanBonuses", 32, 32},
     {"KindOfPercentProductionChange", 32, 32},
     {"UserParser", 4096, 256},
@@ -669,27 +700,43 @@ void User_Memory_Get_DMA_Params(int *count, PoolInitRec const **params)
 {
     // DEBUG_LOG("Retrieving user DynamicMemoryAllocator parameters.\n");
 
-    *count = 7; // Array size UserDMAParameters
+    *count = ARRAY_SIZE(UserDMAParameters);
     *params = UserDMAParameters;
 }
 
-void User_Memory_Init_Pools()
+namespace
 {
-    char path[PATH_MAX];
-    char pool_name[256];
-    int initial_alloc;
-    int overflow_alloc;
+/**
+ * @brief Peak usage of a pool in earlier sessions, used to size it up front on the next launch.
+ */
+struct PoolProfileRec
+{
+    char pool_name[64];
+    int peak_used_count;
+    int overflow_blob_count;
+    bool seen; // Recorded in this session.
+};
 
+PoolProfileRec *s_poolProfile = nullptr;
+int s_poolProfileCount = 0;
+int s_poolProfileCapacity = 0;
+
+const char s_poolProfileFile[] = "MemoryPoolProfile.txt";
+
+/**
+ * @brief Builds the path to a file in the directory the executable is in.
+ */
+void User_Memory_Get_Exe_Relative_Path(char *path, const char *filename)
+{
 #ifdef PLATFORM_WINDOWS
     GetModuleFileNameA(0, path, PATH_MAX);
 #elif defined PLATFORM_LINUX // posix otherwise, really just linux currently
     // TODO /proc/curproc/file for FreeBSD /proc/self/path/a.out Solaris
-    readlink("/proc/self/exe", path, PATH_MAX);
-    dirname(path);
+    ssize_t len = readlink("/proc/self/exe", path, PATH_MAX - 1);
+    path[len > 0 ? len : 0] = '\0';
 #elif defined(PLATFORM_OSX) // osx otherwise
     int size = PATH_MAX;
     _NSGetExecutablePath(path, &size);
-    dirname(path);
 #else //
 #error Platform not supported for Set_Working_Directory()!
 #endif
@@ -710,8 +757,55 @@ void User_Memory_Init_Pools()
         *path_end = '\0';
     }
 
+    strcat(path, filename);
+}
+
+PoolProfileRec *Find_Pool_Profile(const char *name)
+{
+    for (int i = 0; i < s_poolProfileCount; ++i) {
+        if (strcasecmp(s_poolProfile[i].pool_name, name) == 0) {
+            return &s_poolProfile[i];
+        }
+    }
+
+    return nullptr;
+}
+
+PoolProfileRec *Add_Pool_Profile(const char *name)
+{
+    // Runs while the memory manager itself is being set up or torn down so can't use new.
+    if (s_poolProfileCount == s_poolProfileCapacity) {
+        int capacity = std::max(256, s_poolProfileCapacity * 2);
+        PoolProfileRec *profile = static_cast<PoolProfileRec *>(Raw_Allocate(capacity * sizeof(PoolProfileRec)));
+
+        if (s_poolProfile != nullptr) {
+            memcpy(profile, s_poolProfile, s_poolProfileCount * sizeof(PoolProfileRec));
+            Raw_Free(s_poolProfile);
+        }
+
+        s_poolProfile = profile;
+        s_poolProfileCapacity = capacity;
+    }
+
+    PoolProfileRec *psr = &s_poolProfile[s_poolProfileCount++];
+    strlcpy(psr->pool_name, name, sizeof(psr->pool_name));
+    psr->peak_used_count = 0;
+    psr->overflow_blob_count = 0;
+    psr->seen = false;
+
+    return psr;
+}
+} // namespace
+
+void User_Memory_Init_Pools()
+{
+    char path[PATH_MAX];
+    char pool_name[256];
+    int initial_alloc;
+    int overflow_alloc;
+
     // Get the path to the user configurable memory pool ini.
-    strcat(path, "/Data/INI/MemoryPools.ini");
+    User_Memory_Get_Exe_Relative_Path(path, "/Data/INI/MemoryPools.ini");
 
     FILE *fp = fopen(path, "r");
 
@@ -728,5 +822,122 @@ void User_Memory_Init_Pools()
                 }
             }
         }
+
+        fclose(fp);
     }
 }
+
+/**
+ * @brief Loads the pool usage recorded by previous sessions, must run before the first pool is created.
+ */
+void User_Memory_Load_Profile()
+{
+    char path[PATH_MAX];
+    char pool_name[256];
+    int peak_used;
+    int overflow_blobs;
+
+    if (s_poolProfile != nullptr) {
+        return;
+    }
+
+    User_Memory_Get_Exe_Relative_Path(path, "/");
+    strcat(path, s_poolProfileFile);
+
+    FILE *fp = fopen(path, "r");
+
+    if (fp == nullptr) {
+        return;
+    }
+
+    while (fgets(path, PATH_MAX, fp) != nullptr) {
+        if (*path != ';' && sscanf(path, "%255s %d %d", pool_name, &peak_used, &overflow_blobs) == 3 && peak_used >= 0) {
+            PoolProfileRec *psr = Find_Pool_Profile(pool_name);
+
+            if (psr == nullptr) {
+                psr = Add_Pool_Profile(pool_name);
+            }
+
+            psr->peak_used_count = peak_used;
+            psr->overflow_blob_count = overflow_blobs;
+        }
+    }
+
+    fclose(fp);
+}
+
+/**
+ * @brief Sizes a pool from its profiled peak usage so it doesn't need to grow with overflow blobs.
+ *
+ * The initial count gets 1/8th headroom over the recorded peak. If earlier sessions still created several overflow
+ * blobs the overflow count is also raised so any growth that does happen takes fewer steps.
+ */
+void User_Memory_Apply_Profile(const char *name, int &initial_alloc, int &overflow_alloc)
+{
+    PoolProfileRec *psr = Find_Pool_Profile(name);
+
+    if (psr == nullptr || psr->peak_used_count <= 0) {
+        return;
+    }
+
+    initial_alloc = std::max((int)sizeof(void *), Round_Up_Word_Size(psr->peak_used_count + psr->peak_used_count / 8));
+
+    if (psr->overflow_blob_count > 1) {
+        overflow_alloc = std::max(overflow_alloc, Round_Up_Word_Size(psr->peak_used_count / 4));
+    }
+}
+
+/**
+ * @brief Records the usage of a pool from the current session.
+ *
+ * Peaks decay by a quarter each session they aren't reached again so a short session in the menus doesn't shrink
+ * pools that a full game needs, but sizes still come down over time if usage drops.
+ */
+void User_Memory_Record_Profile(const char *name, int peak_used, int overflow_blobs)
+{
+    PoolProfileRec *psr = Find_Pool_Profile(name);
+
+    if (psr == nullptr) {
+        psr = Add_Pool_Profile(name);
+    }
+
+    if (psr->seen) {
+        psr->peak_used_count = std::max(psr->peak_used_count, peak_used);
+        psr->overflow_blob_count = std::max(psr->overflow_blob_count, overflow_blobs);
+    } else {
+        psr->peak_used_count = std::max(peak_used, psr->peak_used_count - psr->peak_used_count / 4);
+        psr->overflow_blob_count = overflow_blobs;
+        psr->seen = true;
+    }
+}
+
+/**
+ * @brief Writes the recorded pool usage out for the next launch to pick up.
+ */
+void User_Memory_Save_Profile()
+{
+    char path[PATH_MAX];
+
+    User_Memory_Get_Exe_Relative_Path(path, "/");
+    strcat(path, s_poolProfileFile);
+
+    FILE *fp = fopen(path, "w");
+
+    if (fp == nullptr) {
+        captainslog_warn("Failed to write memory pool profile '%s'.", path);
+        return;
+    }
+
+    fprintf(fp, "; Generated at shutdown, delete to return to the default pool sizes.\n");
+    fprintf(fp, "; PoolName PeakUsedBlocks OverflowBlobs\n");
+
+    for (int i = 0; i < s_poolProfileCount; ++i) {
+        fprintf(fp,
+            "%s %d %d\n",
+            s_poolProfile[i].pool_name,
+            s_poolProfile[i].peak_used_count,
+            s_poolProfile[i].overflow_blob_count);
+    }
+
+    fclose(fp);
+}
@@ -33,4 +33,8 @@ struct PoolSizeRec
 
 void User_Memory_Adjust_Pool_Size(const char *name, int &initial_alloc, int &overflow_alloc);
 void User_Memory_Get_DMA_Params(int *count, PoolInitRec const **params);
-void User_Memory_Init_Pools();
\ No newline at end of file
+void User_Memory_Init_Pools();
+void User_Memory_Load_Profile();
+void User_Memory_Apply_Profile(const char *name, int &initial_alloc, int &overflow_alloc);
+void User_Memory_Record_Profile(const char *name, int peak_used, int overflow_blobs);
+void User_Memory_Save_Profile();
\ No newline at end of file
@@ -16,7 +16,11 @@
 #include "ramfile.h"
 #include <captainslog.h>
 
+#ifndef GAME_DLL
+std::atomic<int> LocalFile::TotalOpen(0);
+#else
 int LocalFile::TotalOpen = 0;
+#endif
 
 void *LocalFile::Read_All_And_Close()
 {
@@ -17,6 +17,10 @@
 #include "always.h"
 #include "file.h"
 
+#ifndef GAME_DLL
+#include <atomic>
+#endif
+
 class LocalFile : public File
 {
 public:
@@ -24,5 +28,10 @@ public:
     virtual File *Convert_To_RAM() override;
 
 protected:
+#ifndef GAME_DLL
+    // Archives are opened from several threads while loading.
+    static std::atomic<int> TotalOpen;
+#else
     static int TotalOpen;
+#endif
 };
@@ -24,6 +24,9 @@ class File;
 class LocalFileSystem : public SubsystemInterface
 {
 public:
+#ifndef GAME_DLL
+    LocalFileSystem() : m_generation(0) {}
+#endif
     virtual ~LocalFileSystem() {}
 
     virtual File *Open_File(const char *filename, int mode) = 0;
@@ -32,6 +35,14 @@ public:
         std::set<Utf8String, rts::less_than_nocase<Utf8String>> &filelist, bool search_subdirs) = 0;
     virtual bool Get_File_Info(Utf8String const &filename, FileInfo *info) = 0;
     virtual bool Create_Directory(Utf8String) = 0;
+
+#ifndef GAME_DLL
+    // Changes whenever files may have been added to or removed from disk, lets callers know when to drop lookups.
+    unsigned Get_Generation() const { return m_generation; }
+
+protected:
+    unsigned m_generation;
+#endif
 };
 
 #ifdef GAME_DLL
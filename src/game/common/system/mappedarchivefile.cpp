@@ -0,0 +1,59 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief File object giving a read only view of memory owned by an archive.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "mappedarchivefile.h"
+#include <cstring>
+
+using std::memcpy;
+
+MappedArchiveFile::~MappedArchiveFile()
+{
+    // The data isn't ours to free.
+    Data = nullptr;
+}
+
+void MappedArchiveFile::Close()
+{
+    Data = nullptr;
+    RAMFile::Close();
+}
+
+/**
+ * Callers own the returned buffer so they get a copy, Peek_Data lends the view out without one.
+ */
+void *MappedArchiveFile::Read_All_And_Close()
+{
+    char *data = new char[Size > 0 ? Size : 1];
+
+    if (Size > 0) {
+        memcpy(data, Data, Size);
+    }
+
+    Close();
+
+    return data;
+}
+
+bool MappedArchiveFile::Open_View(Utf8String const &name, const void *data, int size)
+{
+    if (data == nullptr || size < 0 || !File::Open(name.Str(), READ | BINARY)) {
+        return false;
+    }
+
+    Data = static_cast<char *>(const_cast<void *>(data));
+    Size = size;
+    Pos = 0;
+
+    return true;
+}
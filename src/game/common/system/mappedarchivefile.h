@@ -0,0 +1,38 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief File object giving a read only view of memory owned by an archive.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "gamememory.h"
+#include "ramfile.h"
+
+/**
+ * RAMFile reading straight from a memory mapped archive rather than its own copy. The data belongs to the archive so
+ * views must be closed before it is.
+ */
+class MappedArchiveFile : public RAMFile
+{
+    IMPLEMENT_POOL(MappedArchiveFile);
+
+public:
+    MappedArchiveFile() {}
+    virtual ~MappedArchiveFile();
+
+    virtual void Close() override;
+    virtual void *Read_All_And_Close() override;
+    virtual bool Open(File *file) override { return false; }
+    virtual bool Open_From_Archive(File *file, Utf8String const &name, int pos, int size) override { return false; }
+
+    bool Open_View(Utf8String const &name, const void *data, int size);
+};
@@ -25,7 +25,18 @@ void MemoryPoolBlob::Init_Blob(MemoryPool *owning_pool, int count)
     m_usedBlocksInBlob = 0;
 
     int alloc_size = Round_Up_Word_Size(owning_pool->m_allocationSize) + sizeof(MemoryPoolSingleBlock);
+#ifndef GAME_DLL
+    // Big blobs such as the initial ones for the busiest DMA pools go straight to the OS so they can use huge pages
+    // and cut down on TLB misses, smaller ones would waste too much of a huge page.
+    if (alloc_size * m_totalBlocksInBlob >= RAW_PAGE_ALLOC_GRANULE) {
+        m_pageAllocSize = alloc_size * m_totalBlocksInBlob;
+        m_blockData = static_cast<char *>(Raw_Allocate_Pages(m_pageAllocSize));
+    } else {
+        m_blockData = static_cast<char *>(Raw_Allocate_No_Zero(alloc_size * m_totalBlocksInBlob));
+    }
+#else
     m_blockData = static_cast<char *>(Raw_Allocate_No_Zero(alloc_size * m_totalBlocksInBlob));
+#endif
     char *current_block = m_blockData;
 
     for (int i = m_totalBlocksInBlob - 1; i >= 0; --i) {
@@ -44,6 +44,9 @@ private:
     int m_usedBlocksInBlob;
     int m_totalBlocksInBlob;
     char *m_blockData;
+#ifndef GAME_DLL
+    int m_pageAllocSize; // Non zero when m_blockData came from Raw_Allocate_Pages.
+#endif
 };
 
 inline MemoryPoolBlob::MemoryPoolBlob() :
@@ -54,11 +57,23 @@ inline MemoryPoolBlob::MemoryPoolBlob() :
     m_usedBlocksInBlob(0),
     m_totalBlocksInBlob(0),
     m_blockData(nullptr)
+#ifndef GAME_DLL
+    ,
+    m_pageAllocSize(0)
+#endif
 {
 }
 
 inline MemoryPoolBlob::~MemoryPoolBlob()
 {
+#ifndef GAME_DLL
+    if (m_pageAllocSize != 0) {
+        Raw_Free_Pages(m_blockData, m_pageAllocSize);
+
+        return;
+    }
+#endif
+
     Raw_Free(m_blockData);
 }
 
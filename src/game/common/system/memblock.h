@@ -26,6 +26,7 @@ class MemoryPoolSingleBlock
     friend class MemoryPoolBlob;
     friend class MemoryPool;
     friend class DynamicMemoryAllocator;
+    friend struct MemoryPoolMagazine;
 
 public:
     MemoryPoolSingleBlock() : m_owningBlob(nullptr), m_nextBlock(nullptr), m_prevBlock(nullptr) {}
@@ -19,6 +19,7 @@
 #include "memblock.h"
 #include "mempool.h"
 #include "mempoolfact.h"
+#include "memtrace.h"
 #include <cstring>
 
 using std::memset;
@@ -36,6 +37,19 @@ DynamicMemoryAllocator::DynamicMemoryAllocator() :
     m_rawBlocks(0)
 {
     memset(m_pools, 0, sizeof(m_pools));
+
+#ifndef GAME_DLL
+    memset(m_sizeClassLookup, MAX_DMA_POOLS, sizeof(m_sizeClassLookup));
+
+#if LOGGING_LEVEL >= LOGLEVEL_INFO
+    for (int i = 0; i <= MAX_DMA_POOLS; ++i) {
+        m_classAllocs[i] = 0;
+        m_classRequestedBytes[i] = 0;
+    }
+
+    m_largestRawAllocation = 0;
+#endif
+#endif
 }
 
 void DynamicMemoryAllocator::Init(MemoryPoolFactory *factory, int subpools, PoolInitRec const *const params)
@@ -62,13 +76,30 @@ void DynamicMemoryAllocator::Init(MemoryPoolFactory *factory, int subpools, Pool
     m_factory = factory;
     m_usedBlocksInDma = 0;
 
-    if (m_poolCount > 8) {
-        m_poolCount = 8;
+    if (m_poolCount > MAX_DMA_POOLS) {
+        m_poolCount = MAX_DMA_POOLS;
     }
 
     for (int i = 0; i < m_poolCount; ++i) {
         m_pools[i] = m_factory->Create_Memory_Pool(&init_list[i]);
     }
+
+#ifndef GAME_DLL
+    // Precompute the smallest pool that fits each granule so lookups don't depend on how many pools there are.
+    for (int i = 0; i < DMA_LOOKUP_ENTRIES; ++i) {
+        int size = i << DMA_GRANULE_SHIFT;
+        int best = MAX_DMA_POOLS;
+
+        for (int j = 0; j < m_poolCount; ++j) {
+            if (size <= m_pools[j]->m_allocationSize
+                && (best == MAX_DMA_POOLS || m_pools[j]->m_allocationSize < m_pools[best]->m_allocationSize)) {
+                best = j;
+            }
+        }
+
+        m_sizeClassLookup[i] = best;
+    }
+#endif
 }
 
 DynamicMemoryAllocator::~DynamicMemoryAllocator()
@@ -87,17 +118,31 @@ DynamicMemoryAllocator::~DynamicMemoryAllocator()
 
 MemoryPool *DynamicMemoryAllocator::Find_Pool_For_Size(int size)
 {
-    if (m_poolCount <= 0) {
-        return nullptr;
+    int size_class = Find_Size_Class(size);
+
+    return size_class >= 0 ? m_pools[size_class] : nullptr;
+}
+
+/**
+ * @brief Gets the index of the pool that serves allocations of the given size, -1 if it must be raw allocated.
+ */
+int DynamicMemoryAllocator::Find_Size_Class(int size)
+{
+#ifndef GAME_DLL
+    if (size >= 0 && size <= DMA_LOOKUP_MAX_SIZE) {
+        int size_class = m_sizeClassLookup[(size + DMA_GRANULE - 1) >> DMA_GRANULE_SHIFT];
+
+        return size_class < m_poolCount ? size_class : -1;
     }
+#endif
 
     for (int i = 0; i < m_poolCount; ++i) {
         if (size <= m_pools[i]->m_allocationSize) {
-            return m_pools[i];
+            return i;
         }
     }
 
-    return nullptr;
+    return -1;
 }
 
 void DynamicMemoryAllocator::Add_To_List(DynamicMemoryAllocator **head)
@@ -133,16 +178,50 @@ void DynamicMemoryAllocator::Remove_From_List(DynamicMemoryAllocator **head)
 
 void *DynamicMemoryAllocator::Allocate_Bytes_No_Zero(int bytes)
 {
+#ifndef GAME_DLL
+    int size_class = Find_Size_Class(bytes);
+#if LOGGING_LEVEL >= LOGLEVEL_INFO
+    int histogram_slot = size_class >= 0 ? size_class : m_poolCount;
+    m_classAllocs[histogram_slot].fetch_add(1, std::memory_order_relaxed);
+    m_classRequestedBytes[histogram_slot].fetch_add(bytes, std::memory_order_relaxed);
+#endif
+
+    // Pooled sizes are served from the thread caches without the DMA lock, so only raw blocks are counted here.
+    if (size_class >= 0) {
+        void *pooled_block = m_pools[size_class]->Allocate_Block_Untraced();
+
+        if (MemoryTrace::Is_Recording()) {
+            MemoryTrace::Record_DMA_Alloc(bytes, pooled_block);
+        }
+
+        return pooled_block;
+    }
+
+    ScopedCriticalSectionClass cs(g_dmaCriticalSection);
+
+#if LOGGING_LEVEL >= LOGLEVEL_INFO
+    if (bytes > m_largestRawAllocation) {
+        m_largestRawAllocation = bytes;
+    }
+#endif
+
+    void *block = MemoryPoolSingleBlock::Raw_Allocate_Single_Block(&m_rawBlocks, bytes, m_factory)->Get_User_Data();
+
+    if (MemoryTrace::Is_Recording()) {
+        MemoryTrace::Record_DMA_Alloc(bytes, block);
+    }
+#else
     ScopedCriticalSectionClass cs(g_dmaCriticalSection);
 
     MemoryPool *mp = Find_Pool_For_Size(bytes);
     void *block;
 
     if (mp != nullptr) {
-        block = mp->Allocate_Block_No_Zero();
+        block = mp->Allocate_Block_Untraced();
     } else {
         block = MemoryPoolSingleBlock::Raw_Allocate_Single_Block(&m_rawBlocks, bytes, m_factory)->Get_User_Data();
     }
+#endif
 
     ++m_usedBlocksInDma;
 
@@ -163,16 +242,32 @@ void DynamicMemoryAllocator::Free_Bytes(void *block)
         return;
     }
 
-    ScopedCriticalSectionClass cs(g_dmaCriticalSection);
-
     MemoryPoolSingleBlock *sblock = MemoryPoolSingleBlock::Recover_Block_From_User_Data(block);
 
+#ifndef GAME_DLL
+    if (MemoryTrace::Is_Recording()) {
+        MemoryTrace::Record_DMA_Free(block);
+    }
+
+    if (sblock->m_owningBlob != nullptr) {
+        sblock->m_owningBlob->m_owningPool->Free_Block_Untraced(block);
+
+        return;
+    }
+
+    ScopedCriticalSectionClass cs(g_dmaCriticalSection);
+    sblock->Remove_Block_From_List(&m_rawBlocks);
+    Raw_Free(sblock);
+#else
+    ScopedCriticalSectionClass cs(g_dmaCriticalSection);
+
     if (sblock->m_owningBlob != nullptr) {
-        sblock->m_owningBlob->m_owningPool->Free_Block(block);
+        sblock->m_owningBlob->m_owningPool->Free_Block_Untraced(block);
     } else {
         sblock->Remove_Block_From_List(&m_rawBlocks);
         Raw_Free(sblock);
     }
+#endif
 
     --m_usedBlocksInDma;
 }
@@ -202,3 +297,43 @@ void DynamicMemoryAllocator::Reset()
 
     m_usedBlocksInDma = 0;
 }
+
+#ifndef GAME_DLL
+/**
+ * @brief Logs the request histogram for each size class to help tune the DMA pool parameters.
+ */
+void DynamicMemoryAllocator::Debug_Size_Class_Report()
+{
+#if LOGGING_LEVEL >= LOGLEVEL_INFO
+    for (int i = 0; i < m_poolCount; ++i) {
+        uint32_t allocs = m_classAllocs[i];
+
+        if (allocs == 0) {
+            continue;
+        }
+
+        uint64_t requested = m_classRequestedBytes[i];
+        uint64_t provided = uint64_t(allocs) * m_pools[i]->m_allocationSize;
+
+        captainslog_info("DMA class %5d bytes ('%s'): %u allocs, avg request %u bytes, %u%% slack, peak %d blocks of %d "
+                         "initial.",
+            m_pools[i]->m_allocationSize,
+            m_pools[i]->m_poolName,
+            allocs,
+            unsigned(requested / allocs),
+            unsigned(provided != 0 ? (provided - requested) * 100 / provided : 0),
+            m_pools[i]->m_peakUsedBlocksInPool,
+            m_pools[i]->m_initialAllocationCount);
+    }
+
+    uint32_t raw_allocs = m_classAllocs[m_poolCount];
+
+    if (raw_allocs != 0) {
+        captainslog_info("DMA raw: %u allocs, avg request %u bytes, largest %d bytes.",
+            raw_allocs,
+            unsigned(m_classRequestedBytes[m_poolCount] / raw_allocs),
+            int(m_largestRawAllocation));
+    }
+#endif
+}
+#endif
@@ -17,6 +17,11 @@
 #include "always.h"
 #include "rawalloc.h"
 
+#ifndef GAME_DLL
+#include <atomic>
+#include <captainslog.h>
+#endif
+
 struct PoolInitRec;
 class MemoryPool;
 class MemoryPoolFactory;
@@ -28,6 +33,20 @@ class DynamicMemoryAllocator
     friend class MemoryPoolFactory;
 
 public:
+    enum
+    {
+#ifdef GAME_DLL
+        MAX_DMA_POOLS = 8,
+#else
+        MAX_DMA_POOLS = 24,
+        // Requests up to DMA_LOOKUP_MAX_SIZE bytes map to a pool through a table indexed in DMA_GRANULE steps.
+        DMA_GRANULE_SHIFT = 4,
+        DMA_GRANULE = 1 << DMA_GRANULE_SHIFT,
+        DMA_LOOKUP_MAX_SIZE = 32768,
+        DMA_LOOKUP_ENTRIES = (DMA_LOOKUP_MAX_SIZE >> DMA_GRANULE_SHIFT) + 1,
+#endif
+    };
+
     DynamicMemoryAllocator();
     void Init(MemoryPoolFactory *factory, int subpools, PoolInitRec const *const params);
     ~DynamicMemoryAllocator();
@@ -39,17 +58,33 @@ public:
     void Free_Bytes(void *block);
     int Get_Actual_Allocation_Size(int bytes);
     void Reset();
+#ifndef GAME_DLL
+    void Debug_Size_Class_Report();
+#endif
 
     void *operator new(size_t size) { return Raw_Allocate_No_Zero(size); }
     void operator delete(void *obj) { Raw_Free(obj); }
 
+private:
+    int Find_Size_Class(int size);
+
 private:
     MemoryPoolFactory *m_factory;
     DynamicMemoryAllocator *m_nextDmaInFactory;
     int m_poolCount;
     int m_usedBlocksInDma;
-    MemoryPool *m_pools[8];
+    MemoryPool *m_pools[MAX_DMA_POOLS];
     MemoryPoolSingleBlock *m_rawBlocks;
+#ifndef GAME_DLL
+    uint8_t m_sizeClassLookup[DMA_LOOKUP_ENTRIES];
+#if LOGGING_LEVEL >= LOGLEVEL_INFO
+    // Histogram of requests per size class, the entry at m_poolCount counts raw allocations. Only kept when it can be
+    // logged as the shared counters would otherwise slow down the lock free pooled path for nothing.
+    std::atomic<uint32_t> m_classAllocs[MAX_DMA_POOLS + 1];
+    std::atomic<uint64_t> m_classRequestedBytes[MAX_DMA_POOLS + 1];
+    std::atomic<int> m_largestRawAllocation;
+#endif
+#endif
 };
 
 #ifdef GAME_DLL
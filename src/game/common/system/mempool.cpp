@@ -16,6 +16,8 @@
 #include "critsection.h"
 #include "memblob.h"
 #include "memblock.h"
+#include "mempoolcache.h"
+#include "memtrace.h"
 #include <algorithm>
 #include <cstring>
 
@@ -23,7 +25,47 @@ using std::memset;
 
 #ifndef GAME_DLL
 SimpleCriticalSectionClass *g_memoryPoolCriticalSection = nullptr;
+
+namespace
+{
+// Upper bound on how much memory a single refill pulls into a thread cache so caches for large objects stay small.
+const int CACHE_BATCH_BYTES = 4096;
+const int CACHE_BATCH_MAX = 32;
+} // namespace
+#endif
+
+/**
+ * @brief Scoped lock on the global pool critical section that also tracks how often it was contended.
+ */
+class MemoryPoolLockClass
+{
+public:
+    MemoryPoolLockClass(MemoryPool *pool) : m_critSection(g_memoryPoolCriticalSection)
+    {
+        if (m_critSection != nullptr) {
+#ifndef GAME_DLL
+            if (!m_critSection->Try_Enter()) {
+                m_critSection->Enter();
+                ++pool->m_lockContentions;
+            }
+
+            ++pool->m_lockAcquisitions;
+#else
+            m_critSection->Enter();
 #endif
+        }
+    }
+
+    ~MemoryPoolLockClass()
+    {
+        if (m_critSection != nullptr) {
+            m_critSection->Leave();
+        }
+    }
+
+private:
+    SimpleCriticalSectionClass *m_critSection;
+};
 
 MemoryPool::MemoryPool() :
     m_factory(nullptr),
@@ -38,11 +80,31 @@ MemoryPool::MemoryPool() :
     m_firstBlob(nullptr),
     m_lastBlob(nullptr),
     m_firstBlobWithFreeBlocks(nullptr)
+#ifndef GAME_DLL
+    ,
+    m_cacheIndex(0),
+    m_cacheBatchCount(1),
+    m_cacheGeneration(0),
+    m_lockAcquisitions(0),
+    m_lockContentions(0),
+    m_cacheRefills(0),
+    m_cacheDrains(0),
+    m_cacheAllocs(0),
+    m_cacheFrees(0)
+#endif
 {
+#ifndef GAME_DLL
+    m_cacheIndex = MemoryPoolThreadCache::Register_Pool(this);
+#endif
 }
 
 MemoryPool::~MemoryPool()
 {
+#ifndef GAME_DLL
+    // Thread caches check the registry before returning blocks so they won't touch the blobs freed below.
+    MemoryPoolThreadCache::Unregister_Pool(this);
+#endif
+
     for (MemoryPoolBlob *b = m_firstBlob; b != nullptr; b = m_firstBlob) {
         Free_Blob(b);
     }
@@ -61,6 +123,9 @@ void MemoryPool::Init(MemoryPoolFactory *factory, const char *name, int size, in
     m_firstBlob = nullptr;
     m_lastBlob = nullptr;
     m_firstBlobWithFreeBlocks = nullptr;
+#ifndef GAME_DLL
+    m_cacheBatchCount = std::min(CACHE_BATCH_MAX, std::max(1, CACHE_BATCH_BYTES / std::max(1, m_allocationSize)));
+#endif
     Create_Blob(count);
 }
 
@@ -97,10 +162,11 @@ int MemoryPool::Free_Blob(MemoryPoolBlob *blob)
     return blob_alloc;
 }
 
-void *MemoryPool::Allocate_Block_No_Zero()
+/**
+ * @brief Takes a single block from the blobs, growing the pool if needed. Caller must hold the pool lock.
+ */
+MemoryPoolSingleBlock *MemoryPool::Allocate_Single_Block_Locked()
 {
-    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
-
     if (m_firstBlobWithFreeBlocks != nullptr && m_firstBlobWithFreeBlocks->m_firstFreeBlock == nullptr) {
         MemoryPoolBlob *i;
         for (i = m_firstBlob; i != nullptr; i = i->m_nextBlob) {
@@ -121,7 +187,79 @@ void *MemoryPool::Allocate_Block_No_Zero()
     ++m_usedBlocksInPool;
     m_peakUsedBlocksInPool = std::max(m_peakUsedBlocksInPool, m_usedBlocksInPool);
 
-    return block->Get_User_Data();
+    return block;
+}
+
+/**
+ * @brief Returns a single block to its blob. Caller must hold the pool lock.
+ */
+void MemoryPool::Free_Single_Block_Locked(MemoryPoolSingleBlock *block)
+{
+    MemoryPoolBlob *mp_blob = block->m_owningBlob;
+
+    captainslog_dbgassert(mp_blob != nullptr && mp_blob->m_owningPool == this, "Block is not part of this pool");
+
+    mp_blob->Free_Single_Block(block);
+
+    if (m_firstBlobWithFreeBlocks == nullptr) {
+        m_firstBlobWithFreeBlocks = mp_blob;
+    }
+
+    --m_usedBlocksInPool;
+}
+
+#ifndef GAME_DLL
+/**
+ * @brief Moves a batch of blocks from the blobs into a thread cache magazine.
+ *
+ * At least one block is always provided, growing the pool if required, but the rest of the batch is only taken
+ * from blocks that are already free so filling a cache never causes an overflow blob on its own.
+ */
+void MemoryPool::Refill_Magazine(MemoryPoolMagazine *magazine)
+{
+    MemoryPoolLockClass lock(this);
+    ++m_cacheRefills;
+    m_cacheAllocs += magazine->allocs;
+    m_cacheFrees += magazine->frees;
+    magazine->allocs = 0;
+    magazine->frees = 0;
+
+    magazine->Push(Allocate_Single_Block_Locked());
+
+    while (magazine->count < m_cacheBatchCount && m_usedBlocksInPool < m_totalBlocksInPool) {
+        magazine->Push(Allocate_Single_Block_Locked());
+    }
+}
+
+/**
+ * @brief Returns up to count blocks from a thread cache magazine to the blobs.
+ */
+void MemoryPool::Drain_Magazine(MemoryPoolMagazine *magazine, int count)
+{
+    MemoryPoolLockClass lock(this);
+    ++m_cacheDrains;
+    m_cacheAllocs += magazine->allocs;
+    m_cacheFrees += magazine->frees;
+    magazine->allocs = 0;
+    magazine->frees = 0;
+
+    for (int i = 0; i < count && magazine->count > 0; ++i) {
+        Free_Single_Block_Locked(magazine->Pop());
+    }
+}
+#endif
+
+void *MemoryPool::Allocate_Block_No_Zero()
+{
+    void *block = Allocate_Block_Untraced();
+
+#ifndef GAME_DLL
+    if (MemoryTrace::Is_Recording()) {
+        MemoryTrace::Record_Pool_Alloc(this, block);
+    }
+#endif
+
+    return block;
 }
 
 void *MemoryPool::Allocate_Block()
@@ -138,18 +276,68 @@ void MemoryPool::Free_Block(void *block)
         return;
     }
 
-    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+#ifndef GAME_DLL
+    if (MemoryTrace::Is_Recording()) {
+        MemoryTrace::Record_Pool_Free(this, block);
+    }
+#endif
+
+    Free_Block_Untraced(block);
+}
+
+/**
+ * @brief Allocates a block without recording it to the memory trace, used for blocks the DMA hands out.
+ */
+void *MemoryPool::Allocate_Block_Untraced()
+{
+#ifndef GAME_DLL
+    MemoryPoolMagazine *magazine = MemoryPoolThreadCache::Get_Magazine(this);
+
+    if (magazine != nullptr) {
+        if (magazine->count == 0) {
+            Refill_Magazine(magazine);
+        }
+
+        ++magazine->allocs;
+
+        return magazine->Pop()->Get_User_Data();
+    }
+#endif
+
+    MemoryPoolLockClass lock(this);
+
+    return Allocate_Single_Block_Locked()->Get_User_Data();
+}
+
+void MemoryPool::Free_Block_Untraced(void *block)
+{
+    if (block == nullptr) {
+        return;
+    }
+
     MemoryPoolSingleBlock *mp_block = MemoryPoolSingleBlock::Recover_Block_From_User_Data(block);
-    MemoryPoolBlob *mp_blob = mp_block->m_owningBlob;
 
-    captainslog_dbgassert(mp_blob != nullptr && mp_blob->m_owningPool == this, "Block is not part of this pool");
+    captainslog_dbgassert(mp_block->m_owningBlob != nullptr && mp_block->m_owningBlob->m_owningPool == this,
+        "Block is not part of this pool");
 
-    mp_blob->Free_Single_Block(mp_block);
+#ifndef GAME_DLL
+    MemoryPoolMagazine *magazine = MemoryPoolThreadCache::Get_Magazine(this);
 
-    if (m_firstBlobWithFreeBlocks == nullptr) {
-        m_firstBlobWithFreeBlocks = mp_blob;
-        --m_usedBlocksInPool;
+    if (magazine != nullptr) {
+        magazine->Push(mp_block);
+        ++magazine->frees;
+
+        // Keep a batch for upcoming allocations on this thread and hand the rest back to the blobs.
+        if (magazine->count >= 2 * m_cacheBatchCount) {
+            Drain_Magazine(magazine, m_cacheBatchCount);
+        }
+
+        return;
     }
+#endif
+
+    MemoryPoolLockClass lock(this);
+    Free_Single_Block_Locked(mp_block);
 }
 
 int MemoryPool::Count_Blobs()
@@ -163,14 +351,25 @@ int MemoryPool::Count_Blobs()
     return count;
 }
 
-int MemoryPool::Release_Empties()
+/**
+ * @brief Frees blobs with no used blocks, returning how many bytes were released.
+ *
+ * Blobs are only freed while at least keep_free_blocks free blocks would remain in the pool afterwards so a pool
+ * that is about to be used again doesn't immediately need a new overflow blob. Caller must hold the pool lock.
+ */
+int MemoryPool::Release_Empties(int keep_free_blocks)
 {
     int count = 0;
 
-    for (MemoryPoolBlob *i = m_firstBlob; i != nullptr; i = i->m_nextBlob) {
-        if (i->m_usedBlocksInBlob == 0) {
+    for (MemoryPoolBlob *i = m_firstBlob; i != nullptr;) {
+        MemoryPoolBlob *next = i->m_nextBlob;
+
+        if (i->m_usedBlocksInBlob == 0
+            && m_totalBlocksInPool - m_usedBlocksInPool - i->m_totalBlocksInBlob >= keep_free_blocks) {
             count += Free_Blob(i);
         }
+
+        i = next;
     }
 
     return count;
@@ -178,6 +377,11 @@ int MemoryPool::Release_Empties()
 
 void MemoryPool::Reset()
 {
+#ifndef GAME_DLL
+    // Invalidate any blocks thread caches are still holding, they are about to be freed with the blobs.
+    ++m_cacheGeneration;
+#endif
+
     for (MemoryPoolBlob *i = m_firstBlob; i != nullptr; i = m_firstBlob) {
         Free_Blob(i);
     }
@@ -219,3 +423,27 @@ void MemoryPool::Remove_From_List(MemoryPool **head)
         *head = m_nextPoolInFactory;
     }
 }
+
+#ifndef GAME_DLL
+/**
+ * @brief Logs how often the pool lock was needed and contended relative to allocations served by thread caches.
+ */
+void MemoryPool::Debug_Contention_Report()
+{
+    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+
+    if (m_lockAcquisitions == 0) {
+        return;
+    }
+
+    captainslog_info("Pool '%s': %llu cached allocs, %llu cached frees, %llu refills, %llu drains, %llu lock acquisitions, "
+                     "%llu contended.",
+        m_poolName,
+        (unsigned long long)m_cacheAllocs,
+        (unsigned long long)m_cacheFrees,
+        (unsigned long long)m_cacheRefills,
+        (unsigned long long)m_cacheDrains,
+        (unsigned long long)m_lockAcquisitions,
+        (unsigned long long)m_lockContentions);
+}
+#endif
@@ -17,9 +17,15 @@
 #include "always.h"
 #include "rawalloc.h"
 
+#ifndef GAME_DLL
+#include <atomic>
+#endif
+
 class MemoryPoolFactory;
 class MemoryPoolBlob;
+class MemoryPoolSingleBlock;
 class SimpleCriticalSectionClass;
+struct MemoryPoolMagazine;
 
 #ifdef GAME_DLL
 extern SimpleCriticalSectionClass *&g_memoryPoolCriticalSection;
@@ -32,6 +38,9 @@ class MemoryPool
     friend class MemoryPoolBlob;
     friend class MemoryPoolFactory;
     friend class DynamicMemoryAllocator;
+    friend class MemoryPoolLockClass;
+    friend class MemoryPoolThreadCache;
+    friend class MemoryTrace;
 
 public:
     MemoryPool();
@@ -43,15 +52,29 @@ public:
     void *Allocate_Block();
     void Free_Block(void *block);
     int Count_Blobs();
-    int Release_Empties();
+    int Release_Empties(int keep_free_blocks = 0);
     void Reset();
     void Add_To_List(MemoryPool **head);
     void Remove_From_List(MemoryPool **head);
     int Get_Alloc_Size() { return m_allocationSize; }
+    const char *Get_Pool_Name() { return m_poolName; }
+#ifndef GAME_DLL
+    void Debug_Contention_Report();
+#endif
 
     void *operator new(size_t size) throw() { return Raw_Allocate(size); }
     void operator delete(void *obj) { Raw_Free(obj); }
 
+private:
+    void *Allocate_Block_Untraced();
+    void Free_Block_Untraced(void *block);
+    MemoryPoolSingleBlock *Allocate_Single_Block_Locked();
+    void Free_Single_Block_Locked(MemoryPoolSingleBlock *block);
+#ifndef GAME_DLL
+    void Refill_Magazine(MemoryPoolMagazine *magazine);
+    void Drain_Magazine(MemoryPoolMagazine *magazine, int count);
+#endif
+
 private:
     MemoryPoolFactory *m_factory;
     MemoryPool *m_nextPoolInFactory;
@@ -65,4 +88,17 @@ private:
     MemoryPoolBlob *m_firstBlob;
     MemoryPoolBlob *m_lastBlob;
     MemoryPoolBlob *m_firstBlobWithFreeBlocks;
+#ifndef GAME_DLL
+    // Used block counts above include blocks parked in thread caches, everything below is only modified under the
+    // pool lock except the generation which thread caches read to detect a Reset.
+    int m_cacheIndex;
+    int m_cacheBatchCount;
+    std::atomic<int> m_cacheGeneration;
+    uint64_t m_lockAcquisitions;
+    uint64_t m_lockContentions;
+    uint64_t m_cacheRefills;
+    uint64_t m_cacheDrains;
+    uint64_t m_cacheAllocs;
+    uint64_t m_cacheFrees;
+#endif
 };
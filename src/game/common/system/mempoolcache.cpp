@@ -0,0 +1,166 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Per thread caches of free blocks that sit in front of the custom memory pools.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "mempoolcache.h"
+
+#ifndef GAME_DLL
+#include "critsection.h"
+#include "mempool.h"
+#include "rawalloc.h"
+#include <algorithm>
+#include <cstring>
+
+using std::memcpy;
+using std::memset;
+
+namespace
+{
+// Live pools indexed by their cache slot, only accessed under g_memoryPoolCriticalSection. Slots are never reused
+// so a stale magazine can't end up returning blocks to the wrong pool.
+MemoryPool **s_registeredPools = nullptr;
+int s_registeredCount = 0;
+int s_registeredCapacity = 0;
+
+thread_local MemoryPoolThreadCache s_threadCache;
+
+// Trivially destructible so it stays valid while other thread locals are torn down after the cache itself.
+thread_local bool s_threadCacheDestroyed = false;
+} // namespace
+
+MemoryPoolThreadCache::MemoryPoolThreadCache() : m_slots(nullptr), m_slotCount(0) {}
+
+MemoryPoolThreadCache::~MemoryPoolThreadCache()
+{
+    Flush();
+    Raw_Free(m_slots);
+    m_slots = nullptr;
+    m_slotCount = 0;
+    s_threadCacheDestroyed = true;
+}
+
+/**
+ * @brief Gets the calling threads magazine for a pool, returns nullptr if the thread is exiting.
+ */
+MemoryPoolMagazine *MemoryPoolThreadCache::Get_Magazine(MemoryPool *pool)
+{
+    if (s_threadCacheDestroyed) {
+        return nullptr;
+    }
+
+    MemoryPoolThreadCache &cache = s_threadCache;
+    int index = pool->m_cacheIndex;
+
+    if (index >= cache.m_slotCount) {
+        cache.Grow(index + 1);
+    }
+
+    MemoryPoolMagazine *magazine = &cache.m_slots[index];
+    int generation = pool->m_cacheGeneration.load(std::memory_order_acquire);
+
+    // Either this thread hasn't used the pool yet or the pool was reset and the cached blocks no longer exist.
+    if (magazine->pool != pool || magazine->generation != generation) {
+        magazine->pool = pool;
+        magazine->head = nullptr;
+        magazine->generation = generation;
+        magazine->count = 0;
+        magazine->allocs = 0;
+        magazine->frees = 0;
+    }
+
+    return magazine;
+}
+
+/**
+ * @brief Returns all blocks cached by the calling thread to their pools.
+ */
+void MemoryPoolThreadCache::Flush_Current_Thread()
+{
+    if (!s_threadCacheDestroyed) {
+        s_threadCache.Flush();
+    }
+}
+
+/**
+ * @brief Assigns a pool the slot it will use in every threads cache.
+ */
+int MemoryPoolThreadCache::Register_Pool(MemoryPool *pool)
+{
+    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+
+    if (s_registeredCount == s_registeredCapacity) {
+        int capacity = std::max(256, s_registeredCapacity * 2);
+        MemoryPool **pools = static_cast<MemoryPool **>(Raw_Allocate(capacity * sizeof(MemoryPool *)));
+
+        if (s_registeredPools != nullptr) {
+            memcpy(pools, s_registeredPools, s_registeredCount * sizeof(MemoryPool *));
+            Raw_Free(s_registeredPools);
+        }
+
+        s_registeredPools = pools;
+        s_registeredCapacity = capacity;
+    }
+
+    s_registeredPools[s_registeredCount] = pool;
+
+    return s_registeredCount++;
+}
+
+void MemoryPoolThreadCache::Unregister_Pool(MemoryPool *pool)
+{
+    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+    int index = pool->m_cacheIndex;
+
+    if (index < s_registeredCount && s_registeredPools[index] == pool) {
+        s_registeredPools[index] = nullptr;
+    }
+}
+
+void MemoryPoolThreadCache::Grow(int slots)
+{
+    int count = std::max(std::max(slots, m_slotCount * 2), 64);
+    MemoryPoolMagazine *new_slots = static_cast<MemoryPoolMagazine *>(Raw_Allocate(count * sizeof(MemoryPoolMagazine)));
+
+    if (m_slots != nullptr) {
+        memcpy(new_slots, m_slots, m_slotCount * sizeof(MemoryPoolMagazine));
+        Raw_Free(m_slots);
+    }
+
+    m_slots = new_slots;
+    m_slotCount = count;
+}
+
+void MemoryPoolThreadCache::Flush()
+{
+    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+
+    for (int i = 0; i < m_slotCount; ++i) {
+        MemoryPoolMagazine *magazine = &m_slots[i];
+        MemoryPool *pool = magazine->pool;
+
+        // Only return blocks to pools that still exist and haven't been reset since the blocks were cached.
+        if (pool != nullptr && i < s_registeredCount && s_registeredPools[i] == pool
+            && magazine->generation == pool->m_cacheGeneration.load(std::memory_order_acquire)) {
+            ++pool->m_cacheDrains;
+            pool->m_cacheAllocs += magazine->allocs;
+            pool->m_cacheFrees += magazine->frees;
+
+            while (magazine->count > 0) {
+                pool->Free_Single_Block_Locked(magazine->Pop());
+            }
+        }
+
+        memset(magazine, 0, sizeof(*magazine));
+    }
+}
+#endif
@@ -0,0 +1,86 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Per thread caches of free blocks that sit in front of the custom memory pools.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "memblock.h"
+
+// The thread caches rely on C++11 thread_local and atomics which the STLPort based hooked build can't provide.
+#ifndef GAME_DLL
+class MemoryPool;
+
+/**
+ * @brief Magazine of free blocks belonging to a single pool, owned by a single thread.
+ *
+ * Blocks held in a magazine are still counted as used by their blob so a pool never releases memory a thread
+ * cache is pointing into. The generation is compared against the pool on every access so that magazines filled
+ * before a pool Reset are discarded rather than handed out.
+ */
+struct MemoryPoolMagazine
+{
+    MemoryPool *pool;
+    MemoryPoolSingleBlock *head;
+    int generation;
+    int count;
+    int allocs;
+    int frees;
+
+    MemoryPoolSingleBlock *Pop();
+    void Push(MemoryPoolSingleBlock *block);
+};
+
+/**
+ * @brief Thread local set of magazines, one per pool the thread has touched.
+ *
+ * Pools are assigned a unique slot index on creation and the per thread slot array grows on demand. When a thread
+ * exits, any blocks it still holds are returned to their pools if the pool is still alive.
+ */
+class MemoryPoolThreadCache
+{
+public:
+    MemoryPoolThreadCache();
+    ~MemoryPoolThreadCache();
+
+    static MemoryPoolMagazine *Get_Magazine(MemoryPool *pool);
+    static void Flush_Current_Thread();
+    static int Register_Pool(MemoryPool *pool);
+    static void Unregister_Pool(MemoryPool *pool);
+
+private:
+    void Grow(int slots);
+    void Flush();
+
+private:
+    MemoryPoolMagazine *m_slots;
+    int m_slotCount;
+};
+
+inline MemoryPoolSingleBlock *MemoryPoolMagazine::Pop()
+{
+    captainslog_dbgassert(head != nullptr, "Popping a block from an empty magazine.");
+    MemoryPoolSingleBlock *block = head;
+    head = block->m_nextBlock;
+    --count;
+
+    return block;
+}
+
+inline void MemoryPoolMagazine::Push(MemoryPoolSingleBlock *block)
+{
+    block->m_nextBlock = head;
+    head = block;
+    ++count;
+}
+#endif
@@ -13,9 +13,11 @@
  *            LICENSE
  */
 #include "mempoolfact.h"
+#include "critsection.h"
 #include "gamememoryinit.h"
 #include "memdynalloc.h"
 #include "mempool.h"
+#include <algorithm>
 #include <captainslog.h>
 #include <cstring>
 
@@ -27,13 +29,14 @@ MemoryPoolFactory *g_memoryPoolFactory = nullptr;
 
 MemoryPoolFactory::~MemoryPoolFactory()
 {
-    for (MemoryPool *mp = m_firstPoolInFactory; m_firstPoolInFactory != nullptr; mp = m_firstPoolInFactory) {
-        Destroy_Memory_Pool(mp);
-    }
-
+    // Allocators destroy their own sub pools so must go first to avoid those pools being destroyed twice.
     for (DynamicMemoryAllocator *dma = m_firstDmaInFactory; m_firstDmaInFactory != nullptr; dma = m_firstDmaInFactory) {
         Destroy_Dynamic_Memory_Allocator(dma);
     }
+
+    for (MemoryPool *mp = m_firstPoolInFactory; m_firstPoolInFactory != nullptr; mp = m_firstPoolInFactory) {
+        Destroy_Memory_Pool(mp);
+    }
 }
 
 MemoryPool *MemoryPoolFactory::Create_Memory_Pool(PoolInitRec const *params)
@@ -53,12 +56,16 @@ MemoryPool *MemoryPoolFactory::Create_Memory_Pool(const char *name, int size, in
     }
 
     User_Memory_Adjust_Pool_Size(name, count, overflow);
+    User_Memory_Apply_Profile(name, count, overflow);
 
     // Count and overflow should never end up as 0 from adjustment.
     captainslog_relassert(count > 0 && overflow > 0, 0xDEAD0002, "Count and overflow are 0 for pool '%s'.", name);
 
     pool = new MemoryPool;
     pool->Init(this, name, size, count, overflow);
+
+    // The pool list is walked by the trim thread so needs the pool lock to change.
+    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
     pool->Add_To_List(&m_firstPoolInFactory);
 
     return pool;
@@ -73,7 +80,11 @@ void MemoryPoolFactory::Destroy_Memory_Pool(MemoryPool *pool)
 
     captainslog_dbgassert(pool->m_usedBlocksInPool == 0, "Destroying none empty pool.");
 
-    pool->Remove_From_List(&m_firstPoolInFactory);
+    {
+        ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+        pool->Remove_From_List(&m_firstPoolInFactory);
+    }
+
     delete pool;
 }
 
@@ -120,3 +131,58 @@ void MemoryPoolFactory::Reset()
         dma->Reset();
     }
 }
+
+/**
+ * @brief Frees empty blobs in every pool, leaving up to watermark_bytes of free blocks in each pool for reuse.
+ */
+int MemoryPoolFactory::Release_Empties(int watermark_bytes)
+{
+    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+    int released = 0;
+
+    for (MemoryPool *mp = m_firstPoolInFactory; mp != nullptr; mp = mp->m_nextPoolInFactory) {
+        released += mp->Release_Empties(watermark_bytes / std::max(1, mp->m_allocationSize));
+    }
+
+    return released;
+}
+
+/**
+ * @brief Records the peak usage of every pool so the next launch can size them up front.
+ */
+void MemoryPoolFactory::Record_Pool_Profile()
+{
+    for (MemoryPool *mp = m_firstPoolInFactory; mp != nullptr; mp = mp->m_nextPoolInFactory) {
+        // Every blob beyond the initial one was created because the pool overflowed.
+        User_Memory_Record_Profile(mp->m_poolName, mp->m_peakUsedBlocksInPool, std::max(0, mp->Count_Blobs() - 1));
+    }
+
+    User_Memory_Save_Profile();
+}
+
+/**
+ * @brief Gets the size of every block held by the pools of this factory whether it is in use or not.
+ */
+int MemoryPoolFactory::Get_Reserved_Bytes()
+{
+    ScopedCriticalSectionClass scs(g_memoryPoolCriticalSection);
+    int reserved = 0;
+
+    for (MemoryPool *mp = m_firstPoolInFactory; mp != nullptr; mp = mp->m_nextPoolInFactory) {
+        reserved += mp->m_totalBlocksInPool * mp->m_allocationSize;
+    }
+
+    return reserved;
+}
+
+#ifndef GAME_DLL
+/**
+ * @brief Logs lock usage for every pool so the effect of the thread caches can be measured.
+ */
+void MemoryPoolFactory::Debug_Contention_Report()
+{
+    for (MemoryPool *mp = m_firstPoolInFactory; mp != nullptr; mp = mp->m_nextPoolInFactory) {
+        mp->Debug_Contention_Report();
+    }
+}
+#endif
@@ -34,6 +34,12 @@ public:
     DynamicMemoryAllocator *Create_Dynamic_Memory_Allocator(int subpools, PoolInitRec const *const params);
     void Destroy_Dynamic_Memory_Allocator(DynamicMemoryAllocator *allocator);
     void Reset();
+    int Release_Empties(int watermark_bytes);
+    void Record_Pool_Profile();
+    int Get_Reserved_Bytes();
+#ifndef GAME_DLL
+    void Debug_Contention_Report();
+#endif
 
     void *operator new(size_t size) throw()
     {
@@ -19,6 +19,10 @@
 #include <captainslog.h>
 #include <new>
 
+#ifndef GAME_DLL
+#include "framearena.h"
+#endif
+
 //
 // Base class for any object requiring efficient memory handling ?
 //
@@ -34,7 +38,9 @@ public:
 
 // Use within a class declaration on a none virtual MemoryPoolObject
 // based class to implement required functions. "classname" must match
-// the name of the class in which it is used.
+// the name of the class in which it is used. The pool is created on first
+// use without any locking, so Create_Class_Pool has to be called before
+// instances are created from more than one thread.
 #define IMPLEMENT_POOL(classname) \
     private: \
         static MemoryPool *Get_Class_Pool() \
@@ -49,6 +55,10 @@ public:
             return The##classname##Pool; \
         } \
     public: \
+        static void Create_Class_Pool() \
+        { \
+            Get_Class_Pool(); \
+        } \
         virtual MemoryPool *Get_Object_Pool() override\
         { \
             return Get_Class_Pool(); \
@@ -85,6 +95,10 @@ public:
             return The##classname##Pool; \
         } \
     public: \
+        static void Create_Class_Pool() \
+        { \
+            Get_Class_Pool(); \
+        } \
         virtual MemoryPool *Get_Object_Pool() override \
         { \
             return Get_Class_Pool(); \
@@ -103,15 +117,43 @@ public:
             return Get_Class_Pool()->Free_Block(ptr); \
         }
 
+#ifndef GAME_DLL
+// Use within a class declaration on a none virtual MemoryPoolObject based
+// class instead of IMPLEMENT_POOL to allocate instances from the FrameArena.
+// Instances still need Delete_Instance to run destructors, but their memory is
+// only reclaimed at the end of the frame so they must never outlive it.
+#define IMPLEMENT_FRAME_ARENA_POOL(classname) \
+    public: \
+        virtual MemoryPool *Get_Object_Pool() override \
+        { \
+            return nullptr; \
+        } \
+        void *operator new(size_t size) \
+        { \
+            return FrameArena::Allocate(size); \
+        } \
+        void *operator new(size_t size, void *dst) \
+        { \
+            return dst; \
+        } \
+        void operator delete(void *p, void *q) {} \
+        void operator delete(void *ptr) {}
+#endif
+
 /**
  * @brief Delete an instance of a MemoryPoolObject, ensuring correct pool is used via virtual call.
+ *
+ * Frame arena objects report no pool, they are destroyed here and their memory reclaimed at the end of the frame.
  */
 inline void Delete_Instance(MemoryPoolObject *ptr)
 {
     if ( ptr != nullptr ) {
         MemoryPool *pool = ptr->Get_Object_Pool();
         ptr->~MemoryPoolObject();
-        pool->Free_Block(ptr);
+
+        if ( pool != nullptr ) {
+            pool->Free_Block(ptr);
+        }
     }
 }
 
@@ -128,7 +170,10 @@ public:
         if ( Obj != nullptr ) {
             MemoryPool *mp = Obj->Get_Object_Pool();
             Obj->~MemoryPoolObject();
-            mp->Free_Block(Obj);
+
+            if ( mp != nullptr ) {
+                mp->Free_Block(Obj);
+            }
         }
     }
 
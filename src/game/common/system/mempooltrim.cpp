@@ -0,0 +1,45 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Background thread returning unused memory pool blobs to the OS.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "mempooltrim.h"
+
+#ifndef GAME_DLL
+#include "mempoolfact.h"
+#include <captainslog.h>
+
+PoolTrimThreadClass *g_thePoolTrimThread = nullptr;
+
+void PoolTrimThreadClass::Thread_Function()
+{
+    // Sleep in short steps so stopping the thread at shutdown doesn't have to wait out a whole interval.
+    const int step_ms = 100;
+    int waited_ms = 0;
+
+    while (m_isRunning) {
+        Sleep_Ms(step_ms);
+        waited_ms += step_ms;
+
+        if (waited_ms < m_intervalMs || g_memoryPoolFactory == nullptr) {
+            continue;
+        }
+
+        waited_ms = 0;
+        int released = g_memoryPoolFactory->Release_Empties(m_watermarkBytes);
+
+        if (released != 0) {
+            captainslog_trace("Pool trim thread released %d bytes of empty blobs.", released);
+        }
+    }
+}
+#endif
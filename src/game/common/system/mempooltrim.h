@@ -0,0 +1,56 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Background thread returning unused memory pool blobs to the OS.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+#include "thread.h"
+
+#ifndef GAME_DLL
+/**
+ * @brief Periodically frees empty pool blobs so long sessions don't hold on to their peak memory use forever.
+ *
+ * Each pass frees empty blobs from every pool in g_memoryPoolFactory while more than the watermark worth of free
+ * blocks would remain in that pool, so pools keep some headroom and don't thrash between freeing and regrowing.
+ */
+class PoolTrimThreadClass : public ThreadClass
+{
+public:
+    enum
+    {
+        DEFAULT_INTERVAL_MS = 30000,
+        DEFAULT_WATERMARK_BYTES = 256 * 1024,
+    };
+
+    PoolTrimThreadClass(const char *thread_name = "Memory pool trim thread") :
+        ThreadClass(thread_name, nullptr),
+        m_intervalMs(DEFAULT_INTERVAL_MS),
+        m_watermarkBytes(DEFAULT_WATERMARK_BYTES)
+    {
+    }
+
+    virtual ~PoolTrimThreadClass() {}
+
+    virtual void Thread_Function() override;
+
+    void Set_Interval(int ms) { m_intervalMs = ms; }
+    void Set_Watermark(int bytes) { m_watermarkBytes = bytes; }
+
+private:
+    volatile int m_intervalMs;
+    volatile int m_watermarkBytes;
+};
+
+extern PoolTrimThreadClass *g_thePoolTrimThread;
+#endif
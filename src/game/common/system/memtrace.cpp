@@ -0,0 +1,215 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Records allocation events from the custom memory manager to a file for offline replay.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "memtrace.h"
+
+#ifndef GAME_DLL
+#include "critsection.h"
+#include "mempool.h"
+#include "rawalloc.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using std::fclose;
+using std::fopen;
+using std::fwrite;
+using std::memcpy;
+using std::strlen;
+
+namespace
+{
+// Spin lock rather than a critical section so it is usable before static constructors have run.
+FastCriticalSectionClass s_traceLock;
+FILE *s_traceFile = nullptr;
+uint8_t s_traceBuffer[MemoryTrace::BUFFER_SIZE];
+int s_traceBufferUsed = 0;
+
+// Pools that already have an EVENT_POOL in the trace, indexed by pool id.
+bool *s_describedPools = nullptr;
+int s_describedCapacity = 0;
+
+/**
+ * @brief Small fixed size buffer an event is assembled in before being appended to the trace.
+ */
+class TraceRecord
+{
+public:
+    TraceRecord(MemoryTrace::TraceEvent event) : m_size(0) { Add<uint8_t>(event); }
+
+    template<typename T> void Add(T value)
+    {
+        memcpy(&m_data[m_size], &value, sizeof(value));
+        m_size += sizeof(value);
+    }
+
+    const uint8_t *Get_Data() const { return m_data; }
+    int Get_Size() const { return m_size; }
+
+private:
+    uint8_t m_data[24];
+    int m_size;
+};
+} // namespace
+
+const char MemoryTrace::TRACE_MAGIC[8] = { 'T', 'H', 'Y', 'M', 'T', 'R', 'C', 'E' };
+std::atomic<bool> MemoryTrace::s_recording(false);
+
+/**
+ * @brief Starts writing allocation events to a file, replacing its contents.
+ */
+bool MemoryTrace::Start(const char *filename)
+{
+    FastCriticalSectionClass::LockClass lock(s_traceLock);
+
+    if (s_traceFile != nullptr) {
+        return false;
+    }
+
+    s_traceFile = fopen(filename, "wb");
+
+    if (s_traceFile == nullptr) {
+        captainslog_warn("Failed to open memory trace file '%s'.", filename);
+
+        return false;
+    }
+
+    int32_t version = TRACE_VERSION;
+    s_traceBufferUsed = 0;
+    Write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    Write(&version, sizeof(version));
+    captainslog_info("Recording memory trace to '%s'.", filename);
+    s_recording.store(true, std::memory_order_release);
+
+    return true;
+}
+
+void MemoryTrace::Stop()
+{
+    s_recording.store(false, std::memory_order_release);
+    FastCriticalSectionClass::LockClass lock(s_traceLock);
+
+    if (s_traceFile == nullptr) {
+        return;
+    }
+
+    Flush();
+    fclose(s_traceFile);
+    s_traceFile = nullptr;
+    Raw_Free(s_describedPools);
+    s_describedPools = nullptr;
+    s_describedCapacity = 0;
+}
+
+void MemoryTrace::Record_Pool_Alloc(MemoryPool *pool, void *block)
+{
+    TraceRecord record(EVENT_POOL_ALLOC);
+    record.Add<uint32_t>(pool->m_cacheIndex);
+    record.Add<uint64_t>(uintptr_t(block));
+    FastCriticalSectionClass::LockClass lock(s_traceLock);
+    Describe_Pool(pool);
+    Write(record.Get_Data(), record.Get_Size());
+}
+
+void MemoryTrace::Record_Pool_Free(MemoryPool *pool, void *block)
+{
+    TraceRecord record(EVENT_POOL_FREE);
+    record.Add<uint32_t>(pool->m_cacheIndex);
+    record.Add<uint64_t>(uintptr_t(block));
+    FastCriticalSectionClass::LockClass lock(s_traceLock);
+    Describe_Pool(pool);
+    Write(record.Get_Data(), record.Get_Size());
+}
+
+void MemoryTrace::Record_DMA_Alloc(int bytes, void *block)
+{
+    TraceRecord record(EVENT_DMA_ALLOC);
+    record.Add<uint32_t>(bytes);
+    record.Add<uint64_t>(uintptr_t(block));
+    FastCriticalSectionClass::LockClass lock(s_traceLock);
+    Write(record.Get_Data(), record.Get_Size());
+}
+
+void MemoryTrace::Record_DMA_Free(void *block)
+{
+    TraceRecord record(EVENT_DMA_FREE);
+    record.Add<uint64_t>(uintptr_t(block));
+    FastCriticalSectionClass::LockClass lock(s_traceLock);
+    Write(record.Get_Data(), record.Get_Size());
+}
+
+/**
+ * @brief Writes the name and block size of a pool the first time it is referenced, must hold the trace lock.
+ */
+void MemoryTrace::Describe_Pool(MemoryPool *pool)
+{
+    int id = pool->m_cacheIndex;
+
+    if (s_traceFile == nullptr) {
+        return;
+    }
+
+    if (id >= s_describedCapacity) {
+        int capacity = std::max(std::max(id + 1, s_describedCapacity * 2), 256);
+        bool *described = static_cast<bool *>(Raw_Allocate(capacity * sizeof(bool)));
+
+        if (s_describedPools != nullptr) {
+            memcpy(described, s_describedPools, s_describedCapacity * sizeof(bool));
+            Raw_Free(s_describedPools);
+        }
+
+        s_describedPools = described;
+        s_describedCapacity = capacity;
+    }
+
+    if (s_describedPools[id]) {
+        return;
+    }
+
+    const char *name = pool->Get_Pool_Name() != nullptr ? pool->Get_Pool_Name() : "";
+    uint8_t name_len = uint8_t(std::min<size_t>(strlen(name), 255));
+    TraceRecord record(EVENT_POOL);
+    record.Add<uint32_t>(id);
+    record.Add<uint32_t>(pool->Get_Alloc_Size());
+    record.Add<uint8_t>(name_len);
+    Write(record.Get_Data(), record.Get_Size());
+    Write(name, name_len);
+    s_describedPools[id] = true;
+}
+
+/**
+ * @brief Appends data to the trace buffer, must hold the trace lock.
+ */
+void MemoryTrace::Write(const void *data, int bytes)
+{
+    if (s_traceFile == nullptr) {
+        return;
+    }
+
+    if (s_traceBufferUsed + bytes > BUFFER_SIZE) {
+        Flush();
+    }
+
+    memcpy(&s_traceBuffer[s_traceBufferUsed], data, bytes);
+    s_traceBufferUsed += bytes;
+}
+
+void MemoryTrace::Flush()
+{
+    if (s_traceBufferUsed > 0) {
+        fwrite(s_traceBuffer, 1, s_traceBufferUsed, s_traceFile);
+        s_traceBufferUsed = 0;
+    }
+}
+#endif
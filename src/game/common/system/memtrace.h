@@ -0,0 +1,69 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Records allocation events from the custom memory manager to a file for offline replay.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+
+// Relies on C++11 atomics which the STLPort based hooked build can't provide.
+#ifndef GAME_DLL
+#include <atomic>
+
+class MemoryPool;
+
+/**
+ * @brief Opt in binary trace of every pool and dynamic allocator allocation and free.
+ *
+ * The trace starts with TRACE_MAGIC and TRACE_VERSION as a 32bit integer, followed by a stream of events. Every
+ * event begins with its TraceEvent byte, all integers are written in native byte order. A pool is described by an
+ * EVENT_POOL event the first time it appears in the trace, later events only refer to it by id. Blocks the dynamic
+ * memory allocator hands out from its own pools are only recorded as DMA events so a replay doesn't count them twice.
+ */
+class MemoryTrace
+{
+public:
+    enum
+    {
+        TRACE_VERSION = 1,
+        BUFFER_SIZE = 64 * 1024,
+    };
+
+    enum TraceEvent
+    {
+        EVENT_POOL, // uint32 pool id, uint32 block size, uint8 name length, name without terminator.
+        EVENT_POOL_ALLOC, // uint32 pool id, uint64 address.
+        EVENT_POOL_FREE, // uint32 pool id, uint64 address.
+        EVENT_DMA_ALLOC, // uint32 requested bytes, uint64 address.
+        EVENT_DMA_FREE, // uint64 address.
+    };
+
+    static const char TRACE_MAGIC[8];
+
+    static bool Start(const char *filename);
+    static void Stop();
+    static bool Is_Recording() { return s_recording.load(std::memory_order_relaxed); }
+    static void Record_Pool_Alloc(MemoryPool *pool, void *block);
+    static void Record_Pool_Free(MemoryPool *pool, void *block);
+    static void Record_DMA_Alloc(int bytes, void *block);
+    static void Record_DMA_Free(void *block);
+
+private:
+    static void Describe_Pool(MemoryPool *pool);
+    static void Write(const void *data, int bytes);
+    static void Flush();
+
+private:
+    static std::atomic<bool> s_recording;
+};
+#endif
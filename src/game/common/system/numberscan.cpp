@@ -0,0 +1,478 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Locale independent scanning of decimal numbers.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "numberscan.h"
+#include <algorithm>
+#include <captainslog.h>
+#include <cstdio>
+#include <cstring>
+
+using std::memcpy;
+using std::memset;
+
+namespace
+{
+enum
+{
+    FAST_DIGITS_MAX = 19, // Any 19 digits fit in 64 bits.
+    FAST_EXPONENT_MAX = 18, // Powers of ten up to this leave room to shift a remainder left a few bits at a time.
+    DIGITS_MAX = 200, // Enough to tell which side of a rounding boundary any float sized number is on.
+    EXPONENT_LIMIT = 100000, // Exponent digits saturate here, far past any float but short of overflowing an int.
+    BIG_WORDS = 40, // Enough for DIGITS_MAX digits below the smallest float along with the shifts done on them.
+    FLOAT_MANT_BITS = 24,
+    FLOAT_EXP_MIN = -149, // Binary exponent of the lowest mantissa bit of denormals.
+    FLOAT_EXP_BIAS = 150, // Bias of the exponent field for a mantissa with its top bit at 2^23.
+    FLOAT_EXP_INF = 255,
+};
+
+const uint64_t s_powersOfTen[] = {
+    1ull,
+    10ull,
+    100ull,
+    1000ull,
+    10000ull,
+    100000ull,
+    1000000ull,
+    10000000ull,
+    100000000ull,
+    1000000000ull,
+    10000000000ull,
+    100000000000ull,
+    1000000000000ull,
+    10000000000000ull,
+    100000000000000ull,
+    1000000000000000ull,
+    10000000000000000ull,
+    100000000000000000ull,
+    1000000000000000000ull,
+    10000000000000000000ull,
+};
+
+/**
+ * @brief Unsigned integer of fixed capacity, only has what's needed to divide one number of digits by a power of ten.
+ */
+class BigNumber
+{
+public:
+    BigNumber(uint32_t value = 0) : m_size(value != 0 ? 1 : 0) { m_words[0] = value; }
+
+    bool Is_Zero() const { return m_size == 0; }
+
+    int Bit_Length() const
+    {
+        if (m_size == 0) {
+            return 0;
+        }
+
+        int length = (m_size - 1) * 32;
+
+        for (uint32_t top = m_words[m_size - 1]; top != 0; top >>= 1) {
+            ++length;
+        }
+
+        return length;
+    }
+
+    void Multiply_Add(uint32_t multiplier, uint32_t addend)
+    {
+        uint64_t carry = addend;
+
+        for (int i = 0; i < m_size; ++i) {
+            carry += uint64_t(m_words[i]) * multiplier;
+            m_words[i] = uint32_t(carry);
+            carry >>= 32;
+        }
+
+        if (carry != 0) {
+            captainslog_dbgassert(m_size < BIG_WORDS, "BigNumber overflowed.");
+            m_words[m_size++] = uint32_t(carry);
+        }
+    }
+
+    void Multiply_Power_Of_Ten(int power)
+    {
+        for (; power >= 9; power -= 9) {
+            Multiply_Add(1000000000u, 0);
+        }
+
+        Multiply_Add(uint32_t(s_powersOfTen[power]), 0);
+    }
+
+    void Shift_Left(int bits)
+    {
+        if (m_size == 0 || bits == 0) {
+            return;
+        }
+
+        int words = bits / 32;
+        bits %= 32;
+        int size = m_size + words + (bits != 0 ? 1 : 0);
+        captainslog_dbgassert(size <= BIG_WORDS, "BigNumber overflowed.");
+
+        for (int i = size - 1; i >= words; --i) {
+            uint64_t value = uint64_t(i - words < m_size ? m_words[i - words] : 0) << 32;
+
+            if (bits != 0 && i - words - 1 >= 0) {
+                value |= m_words[i - words - 1];
+            }
+
+            m_words[i] = uint32_t(value >> (32 - bits));
+        }
+
+        memset(m_words, 0, words * sizeof(m_words[0]));
+        m_size = size;
+        Trim();
+    }
+
+    void Shift_Right_One()
+    {
+        for (int i = 0; i < m_size; ++i) {
+            m_words[i] = (m_words[i] >> 1) | (i + 1 < m_size ? m_words[i + 1] << 31 : 0);
+        }
+
+        Trim();
+    }
+
+    // Only valid when this is no less than other.
+    void Subtract(BigNumber const &other)
+    {
+        int64_t borrow = 0;
+
+        for (int i = 0; i < m_size; ++i) {
+            int64_t value = int64_t(m_words[i]) - (i < other.m_size ? other.m_words[i] : 0) - borrow;
+            borrow = value < 0 ? 1 : 0;
+            m_words[i] = uint32_t(value);
+        }
+
+        Trim();
+    }
+
+    int Compare(BigNumber const &other) const
+    {
+        if (m_size != other.m_size) {
+            return m_size < other.m_size ? -1 : 1;
+        }
+
+        for (int i = m_size - 1; i >= 0; --i) {
+            if (m_words[i] != other.m_words[i]) {
+                return m_words[i] < other.m_words[i] ? -1 : 1;
+            }
+        }
+
+        return 0;
+    }
+
+private:
+    void Trim()
+    {
+        while (m_size > 0 && m_words[m_size - 1] == 0) {
+            --m_size;
+        }
+    }
+
+private:
+    uint32_t m_words[BIG_WORDS];
+    int m_size;
+};
+
+bool Is_Space(char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+bool Is_Digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+int Bit_Length(uint64_t value)
+{
+#if defined __GNUC__ || defined __clang__
+    return value != 0 ? 64 - __builtin_clzll(value) : 0;
+#else
+    int length = 0;
+
+    for (; value >= 0x10000; value >>= 16) {
+        length += 16;
+    }
+
+    for (; value != 0; value >>= 1) {
+        ++length;
+    }
+
+    return length;
+#endif
+}
+
+/**
+ * @brief Rounds (mantissa + fraction) * 2^exponent to a float, inexact is set when the fraction isn't zero.
+ */
+float Make_Float(uint64_t mantissa, bool inexact, int exponent, bool negative)
+{
+    // Callers pass at least two bits more than a float holds whenever the fraction isn't zero.
+    int shift = std::max(Bit_Length(mantissa) - int(FLOAT_MANT_BITS), int(FLOAT_EXP_MIN) - exponent);
+
+    if (shift > 64) {
+        mantissa = 0;
+    } else if (shift > 0) {
+        uint64_t lost = shift == 64 ? mantissa : mantissa & ((uint64_t(1) << shift) - 1);
+        uint64_t half = uint64_t(1) << (shift - 1);
+        mantissa = shift == 64 ? 0 : mantissa >> shift;
+        exponent += shift;
+
+        // Ties go to even.
+        if (lost > half || (lost == half && (inexact || (mantissa & 1) != 0))) {
+            ++mantissa;
+        }
+    } else if (shift < 0) {
+        mantissa <<= -shift;
+        exponent += shift;
+    }
+
+    if (mantissa == uint64_t(1) << FLOAT_MANT_BITS) {
+        mantissa >>= 1;
+        ++exponent;
+    }
+
+    uint32_t bits;
+
+    if (mantissa == 0) {
+        bits = 0;
+    } else if (mantissa < uint64_t(1) << (FLOAT_MANT_BITS - 1)) {
+        bits = uint32_t(mantissa);
+    } else if (exponent + FLOAT_EXP_BIAS >= FLOAT_EXP_INF) {
+        bits = uint32_t(FLOAT_EXP_INF) << (FLOAT_MANT_BITS - 1);
+    } else {
+        bits = (uint32_t(exponent + FLOAT_EXP_BIAS) << (FLOAT_MANT_BITS - 1))
+            | (uint32_t(mantissa) & ((1u << (FLOAT_MANT_BITS - 1)) - 1));
+    }
+
+    if (negative) {
+        bits |= 0x80000000u;
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+/**
+ * @brief Divides digits * 10^exponent exactly, for numbers the 64 bit path can't handle.
+ */
+float Make_Float_Slow(const char *digits, int significant, int exponent, bool negative)
+{
+    BigNumber numerator;
+    bool inexact = false;
+    int taken = 0;
+
+    // Digits past DIGITS_MAX can only move a number that is already off a rounding boundary.
+    for (const char *c = digits; taken < significant; ++c) {
+        if (!Is_Digit(*c)) {
+            continue;
+        }
+
+        if (taken < DIGITS_MAX) {
+            numerator.Multiply_Add(10, uint32_t(*c - '0'));
+        } else if (*c != '0') {
+            inexact = true;
+        }
+
+        ++taken;
+    }
+
+    exponent += std::max(significant - int(DIGITS_MAX), 0);
+    BigNumber denominator(1);
+
+    if (exponent >= 0) {
+        numerator.Multiply_Power_Of_Ten(exponent);
+    } else {
+        denominator.Multiply_Power_Of_Ten(-exponent);
+    }
+
+    // Scale so the quotient has 26 or 27 bits, two more than a float to round with.
+    int shift = denominator.Bit_Length() - numerator.Bit_Length() + FLOAT_MANT_BITS + 2;
+
+    if (shift > 0) {
+        numerator.Shift_Left(shift);
+    } else {
+        denominator.Shift_Left(-shift);
+    }
+
+    uint64_t quotient = 0;
+    denominator.Shift_Left(FLOAT_MANT_BITS + 2);
+
+    for (int i = FLOAT_MANT_BITS + 2; i >= 0; --i) {
+        if (numerator.Compare(denominator) >= 0) {
+            numerator.Subtract(denominator);
+            quotient |= uint64_t(1) << i;
+        }
+
+        denominator.Shift_Right_One();
+    }
+
+    return Make_Float(quotient, inexact || !numerator.Is_Zero(), -shift, negative);
+}
+
+const char *Scan_Float_C(const char *str, float &value)
+{
+    int length;
+
+    if (sscanf(str, "%f%n", &value, &length) != 1) {
+        return nullptr;
+    }
+
+    return str + length;
+}
+
+template<typename T> const char *Scan_Integer(const char *str, T &value)
+{
+    const char *c = str;
+
+    while (Is_Space(*c)) {
+        ++c;
+    }
+
+    bool negative = *c == '-';
+
+    if (*c == '+' || *c == '-') {
+        ++c;
+    }
+
+    if (!Is_Digit(*c)) {
+        return nullptr;
+    }
+
+    uint32_t result = 0;
+
+    for (; Is_Digit(*c); ++c) {
+        result = result * 10 + uint32_t(*c - '0');
+    }
+
+    value = T(negative ? 0u - result : result);
+
+    return c;
+}
+} // namespace
+
+namespace rts
+{
+const char *Scan_Int32(const char *str, int32_t &value)
+{
+    return Scan_Integer(str, value);
+}
+
+const char *Scan_UInt32(const char *str, uint32_t &value)
+{
+    return Scan_Integer(str, value);
+}
+
+const char *Scan_Float(const char *str, float &value)
+{
+    const char *c = str;
+
+    while (Is_Space(*c)) {
+        ++c;
+    }
+
+    bool negative = *c == '-';
+
+    if (*c == '+' || *c == '-') {
+        ++c;
+    }
+
+    if ((!Is_Digit(c[0]) && (c[0] != '.' || !Is_Digit(c[1]))) || (c[0] == '0' && (c[1] == 'x' || c[1] == 'X'))) {
+        return Scan_Float_C(str, value);
+    }
+
+    // The number is digits * 10^exponent, only the first FAST_DIGITS_MAX digits are collected here.
+    const char *digits = nullptr;
+    uint64_t mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    bool point = false;
+
+    for (;; ++c) {
+        if (Is_Digit(*c)) {
+            if (significant == 0 && *c == '0') {
+                exponent -= point ? 1 : 0;
+                continue;
+            }
+
+            if (significant == 0) {
+                digits = c;
+            }
+
+            if (significant < FAST_DIGITS_MAX) {
+                mantissa = mantissa * 10 + uint64_t(*c - '0');
+            }
+
+            ++significant;
+            exponent -= point ? 1 : 0;
+        } else if (*c == '.' && !point) {
+            point = true;
+        } else {
+            break;
+        }
+    }
+
+    if ((*c == 'e' || *c == 'E') && (Is_Digit(c[1]) || ((c[1] == '+' || c[1] == '-') && Is_Digit(c[2])))) {
+        bool negative_exponent = c[1] == '-';
+        c += Is_Digit(c[1]) ? 1 : 2;
+        int value = 0;
+
+        for (; Is_Digit(*c); ++c) {
+            value = std::min(value * 10 + (*c - '0'), int(EXPONENT_LIMIT));
+        }
+
+        exponent += negative_exponent ? -value : value;
+    }
+
+    // Anything from 1e39 up is past the largest float, anything under 1e-46 is less than half the smallest.
+    if (significant == 0 || significant + exponent < -45) {
+        value = Make_Float(0, false, 0, negative);
+    } else if (significant + exponent > 39) {
+        value = Make_Float(1, false, FLOAT_EXP_INF, negative);
+    } else if (significant > FAST_DIGITS_MAX) {
+        value = Make_Float_Slow(digits, significant, exponent, negative);
+    } else if (exponent >= 0) {
+        if (exponent <= FAST_DIGITS_MAX && mantissa <= UINT64_MAX / s_powersOfTen[exponent]) {
+            value = Make_Float(mantissa * s_powersOfTen[exponent], false, 0, negative);
+        } else {
+            value = Make_Float_Slow(digits, significant, exponent, negative);
+        }
+    } else if (-exponent <= FAST_EXPONENT_MAX) {
+        // Long division by the power of ten, taking as many bits at a time as the remainder has room for.
+        uint64_t divisor = s_powersOfTen[-exponent];
+        uint64_t quotient = mantissa / divisor;
+        uint64_t remainder = mantissa % divisor;
+        int binary_exponent = 0;
+        int divisor_length = Bit_Length(divisor);
+
+        for (int length = Bit_Length(quotient); length < FLOAT_MANT_BITS + 2; length = Bit_Length(quotient)) {
+            int shift = std::min(63 - divisor_length, 64 - length);
+            remainder <<= shift;
+            quotient = (quotient << shift) | (remainder / divisor);
+            remainder %= divisor;
+            binary_exponent -= shift;
+        }
+
+        value = Make_Float(quotient, remainder != 0, binary_exponent, negative);
+    } else {
+        value = Make_Float_Slow(digits, significant, exponent, negative);
+    }
+
+    return c;
+}
+} // namespace rts
@@ -0,0 +1,32 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Locale independent scanning of decimal numbers.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+
+/**
+ * Drop in replacements for sscanf with %d, %u and %f. Leading white space is skipped and scanning stops at the first
+ * character that isn't part of the number, the end of the number is returned or nullptr if there wasn't one. Integers
+ * wrap on overflow, floats are rounded to nearest even exactly however many digits they have using only integer math
+ * so the result doesn't depend on the locale or how the FPU is set up. Exponents saturate at 100000 as they are read,
+ * so exponents of any length give infinity or zero rather than overflowing. Hexadecimal floats, infinity and nan are
+ * rare enough that they are still handed to the C library. tools/numscan.cpp checks all of this against sscanf.
+ */
+namespace rts
+{
+const char *Scan_Int32(const char *str, int32_t &value);
+const char *Scan_UInt32(const char *str, uint32_t &value);
+const char *Scan_Float(const char *str, float &value);
+} // namespace rts
@@ -327,3 +327,20 @@ bool RAMFile::Copy_To_File(File *file)
 {
     return file != nullptr && file->Write(Data, Size) == Size;
 }
+
+/**
+ * Opens the file on a buffer allocated with new[] that was read elsewhere, the file takes ownership of it.
+ */
+bool RAMFile::Open_Buffer(Utf8String const &name, char *data, int size)
+{
+    if (data == nullptr || size < 0 || !File::Open(name.Str(), READ | BINARY)) {
+        return false;
+    }
+
+    delete[] Data;
+    Data = data;
+    Size = size;
+    Pos = 0;
+
+    return true;
+}
@@ -36,10 +36,15 @@ public:
 
     virtual void *Read_All_And_Close() override;
     virtual RAMFile *Convert_To_RAM() override { return this; }
+#ifndef GAME_DLL
+    virtual const void *Peek_Data() override { return Data; }
+#endif
     virtual bool Open(File *file);
     virtual bool Open_From_Archive(File *file, Utf8String const &name, int pos, int size);
     virtual bool Copy_To_File(File *file);
 
+    bool Open_Buffer(Utf8String const &name, char *data, int size);
+
 protected:
     char *Data;
     int Pos;
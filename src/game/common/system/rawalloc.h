@@ -100,6 +100,52 @@ inline void *Raw_Allocate_No_Zero(int bytes)
 inline void Raw_Free(void *memory) { if ( memory != nullptr ) free(memory); }
 #endif
 
+// Pages from the OS are requested in huge page sized steps so they can be backed by huge pages where supported.
+#define RAW_PAGE_ALLOC_GRANULE (2 * 1024 * 1024)
+
+#ifdef PLATFORM_LINUX
+#include <sys/mman.h>
+
+/**
+ * @brief Allocates memory directly from the OS, backed by huge pages where possible. Contents will be zeroed.
+ *
+ * Explicit huge pages are used if any have been reserved, otherwise transparent huge pages are requested.
+ */
+inline void *Raw_Allocate_Pages(int bytes)
+{
+    size_t size = (size_t(bytes) + RAW_PAGE_ALLOC_GRANULE - 1) & ~size_t(RAW_PAGE_ALLOC_GRANULE - 1);
+    void *r = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+    r = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+
+    if (r == MAP_FAILED) {
+        r = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        captainslog_relassert(r != MAP_FAILED, 0xDEAD0002, "Memory allocation failed.");
+
+#ifdef MADV_HUGEPAGE
+        madvise(r, size, MADV_HUGEPAGE);
+#endif
+    }
+
+    return r;
+}
+
+/**
+ * @brief Frees memory from Raw_Allocate_Pages, bytes must match the size it was allocated with.
+ */
+inline void Raw_Free_Pages(void *memory, int bytes)
+{
+    if (memory != nullptr) {
+        munmap(memory, (size_t(bytes) + RAW_PAGE_ALLOC_GRANULE - 1) & ~size_t(RAW_PAGE_ALLOC_GRANULE - 1));
+    }
+}
+#else
+inline void *Raw_Allocate_Pages(int bytes) { return Raw_Allocate(bytes); }
+inline void Raw_Free_Pages(void *memory, int bytes) { Raw_Free(memory); }
+#endif
+
 inline int Round_Up_4(int number) { return (number + 3) & (~3); }   // For 4byte alignment
 inline int Round_Up_8(int number) { return (number + 7) & (~7); }   // For 8bytes alignment
 /**
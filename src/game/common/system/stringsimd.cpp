@@ -0,0 +1,334 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Vectorised helpers for ASCII case folding, comparison and UTF-16 conversion.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "stringsimd.h"
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define STRING_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Comparisons read whole 16 byte blocks past the terminator, which is safe as the block never crosses a page but
+// is reported by the address sanitizer.
+#if defined __GNUC__ || defined __clang__
+#define STRING_SIMD_NO_ASAN __attribute__((no_sanitize_address))
+#else
+#define STRING_SIMD_NO_ASAN
+#endif
+
+namespace
+{
+enum
+{
+    PAGE_SIZE_MIN = 4096,
+    BLOCK_SIZE = 16,
+};
+
+inline unsigned char Fold(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : (unsigned char)c;
+}
+
+#ifdef STRING_SIMD_SSE2
+inline int Lowest_Set_Bit(unsigned mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+
+    return int(index);
+#else
+    return __builtin_ctz(mask);
+#endif
+}
+
+inline bool Block_Within_Page(const void *p)
+{
+    return (uintptr_t(p) & (PAGE_SIZE_MIN - 1)) <= PAGE_SIZE_MIN - BLOCK_SIZE;
+}
+
+inline __m128i Upper_Mask(__m128i v)
+{
+    // Bytes above 0x7F are negative as signed chars so never fall in the range.
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+}
+
+inline __m128i Fold_Block(__m128i v)
+{
+    return _mm_add_epi8(v, _mm_and_si128(Upper_Mask(v), _mm_set1_epi8('a' - 'A')));
+}
+#endif
+} // namespace
+
+namespace rts
+{
+/**
+ * @brief Checks if any character in a string is an upper case ASCII letter.
+ */
+bool Has_Upper_Ascii(const char *s, int len)
+{
+    int i = 0;
+#ifdef STRING_SIMD_SSE2
+    for (; i + BLOCK_SIZE <= len; i += BLOCK_SIZE) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+
+        if (_mm_movemask_epi8(Upper_Mask(v)) != 0) {
+            return true;
+        }
+    }
+#endif
+    for (; i < len; ++i) {
+        if (s[i] >= 'A' && s[i] <= 'Z') {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Lower cases the ASCII letters of a string in place.
+ */
+void To_Lower_Ascii(char *s, int len)
+{
+    int i = 0;
+#ifdef STRING_SIMD_SSE2
+    for (; i + BLOCK_SIZE <= len; i += BLOCK_SIZE) {
+        __m128i *p = reinterpret_cast<__m128i *>(s + i);
+        _mm_storeu_si128(p, Fold_Block(_mm_loadu_si128(p)));
+    }
+#endif
+    for (; i < len; ++i) {
+        s[i] = char(Fold(s[i]));
+    }
+}
+
+/**
+ * @brief Case insensitive comparison of two null terminated strings with the same result as strcasecmp.
+ */
+STRING_SIMD_NO_ASAN int Compare_No_Case(const char *left, const char *right)
+{
+    for (;;) {
+#ifdef STRING_SIMD_SSE2
+        if (Block_Within_Page(left) && Block_Within_Page(right)) {
+            __m128i l = Fold_Block(_mm_loadu_si128(reinterpret_cast<const __m128i *>(left)));
+            __m128i r = Fold_Block(_mm_loadu_si128(reinterpret_cast<const __m128i *>(right)));
+            unsigned mask = (~unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(l, r))) & 0xFFFF)
+                | unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(l, _mm_setzero_si128())));
+
+            if (mask != 0) {
+                int i = Lowest_Set_Bit(mask);
+
+                return int(Fold(left[i])) - int(Fold(right[i]));
+            }
+
+            left += BLOCK_SIZE;
+            right += BLOCK_SIZE;
+
+            continue;
+        }
+#endif
+        int l = Fold(*left++);
+        int r = Fold(*right++);
+
+        if (l != r || l == 0) {
+            return l - r;
+        }
+    }
+}
+
+/**
+ * @brief Case insensitive comparison of at most count characters with the same result as strncasecmp.
+ */
+STRING_SIMD_NO_ASAN int Compare_No_Case(const char *left, const char *right, int count)
+{
+    while (count > 0) {
+#ifdef STRING_SIMD_SSE2
+        if (Block_Within_Page(left) && Block_Within_Page(right)) {
+            __m128i l = Fold_Block(_mm_loadu_si128(reinterpret_cast<const __m128i *>(left)));
+            __m128i r = Fold_Block(_mm_loadu_si128(reinterpret_cast<const __m128i *>(right)));
+            unsigned mask = (~unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(l, r))) & 0xFFFF)
+                | unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(l, _mm_setzero_si128())));
+
+            if (count < BLOCK_SIZE) {
+                mask &= (1u << count) - 1;
+            }
+
+            if (mask != 0) {
+                int i = Lowest_Set_Bit(mask);
+
+                return int(Fold(left[i])) - int(Fold(right[i]));
+            }
+
+            left += BLOCK_SIZE;
+            right += BLOCK_SIZE;
+            count -= BLOCK_SIZE;
+
+            continue;
+        }
+#endif
+        int l = Fold(*left++);
+        int r = Fold(*right++);
+
+        if (l != r || l == 0) {
+            return l - r;
+        }
+
+        --count;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Checks if a UTF-8 string only contains ASCII characters.
+ */
+bool Is_Ascii(const char *s, int len)
+{
+    int i = 0;
+#ifdef STRING_SIMD_SSE2
+    __m128i bits = _mm_setzero_si128();
+
+    for (; i + BLOCK_SIZE <= len; i += BLOCK_SIZE) {
+        bits = _mm_or_si128(bits, _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)));
+    }
+
+    if (_mm_movemask_epi8(bits) != 0) {
+        return false;
+    }
+#endif
+    for (; i < len; ++i) {
+        if ((unsigned char)s[i] > 0x7F) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Checks if a UTF-16 string only contains ASCII characters.
+ */
+bool Is_Ascii(const unichar_t *s, int len)
+{
+    int i = 0;
+#ifdef STRING_SIMD_SSE2
+    if (sizeof(unichar_t) == 2) {
+        __m128i bits = _mm_setzero_si128();
+
+        for (; i + 8 <= len; i += 8) {
+            bits = _mm_or_si128(bits, _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i)));
+        }
+
+        // Any bit above the lowest seven in either byte of a character makes it none ASCII.
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(bits, _mm_set1_epi16(-0x80)), _mm_setzero_si128()))
+            != 0xFFFF) {
+            return false;
+        }
+    }
+#endif
+    for (; i < len; ++i) {
+        if (unsigned(s[i]) > 0x7F) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Converts an ASCII string to UTF-16, len characters are written with no terminator.
+ */
+void Widen_Ascii(unichar_t *dst, const char *src, int len)
+{
+    int i = 0;
+#ifdef STRING_SIMD_SSE2
+    if (sizeof(unichar_t) == 2) {
+        for (; i + BLOCK_SIZE <= len; i += BLOCK_SIZE) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_unpacklo_epi8(v, _mm_setzero_si128()));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i + 8), _mm_unpackhi_epi8(v, _mm_setzero_si128()));
+        }
+    }
+#endif
+    for (; i < len; ++i) {
+        dst[i] = unichar_t((unsigned char)src[i]);
+    }
+}
+
+/**
+ * @brief Converts an ASCII only UTF-16 string to UTF-8, len characters are written with no terminator.
+ */
+void Narrow_Ascii(char *dst, const unichar_t *src, int len)
+{
+    int i = 0;
+#ifdef STRING_SIMD_SSE2
+    if (sizeof(unichar_t) == 2) {
+        for (; i + BLOCK_SIZE <= len; i += BLOCK_SIZE) {
+            __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packus_epi16(lo, hi));
+        }
+    }
+#endif
+    for (; i < len; ++i) {
+        dst[i] = char(src[i]);
+    }
+}
+
+/**
+ * @brief Finds where the text of a line ends at a comment character, line feed or nul and turns the control
+ * characters before it into spaces. Returns len if the text runs to the end.
+ */
+int Clean_Line(char *s, int len, char comment)
+{
+    int i = 0;
+#ifdef STRING_SIMD_SSE2
+    for (; i + BLOCK_SIZE <= len; i += BLOCK_SIZE) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+        __m128i stop = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(comment)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(v, _mm_setzero_si128())));
+
+        // The block the text ends in is finished off below.
+        if (_mm_movemask_epi8(stop) != 0) {
+            break;
+        }
+
+        // Bytes above 0x7F are negative as signed chars so aren't control characters.
+        __m128i control =
+            _mm_and_si128(_mm_cmpgt_epi8(v, _mm_setzero_si128()), _mm_cmplt_epi8(v, _mm_set1_epi8(' ')));
+
+        if (_mm_movemask_epi8(control) != 0) {
+            v = _mm_or_si128(_mm_andnot_si128(control, v), _mm_and_si128(control, _mm_set1_epi8(' ')));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(s + i), v);
+        }
+    }
+#endif
+    for (; i < len; ++i) {
+        if (s[i] == comment || s[i] == '\n' || s[i] == '\0') {
+            return i;
+        }
+
+        if ((unsigned char)s[i] < ' ') {
+            s[i] = ' ';
+        }
+    }
+
+    return len;
+}
+} // namespace rts
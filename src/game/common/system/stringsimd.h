@@ -0,0 +1,34 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Vectorised helpers for ASCII case folding, comparison, UTF-16 conversion and line scanning.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "always.h"
+
+/**
+ * These process 16 bytes at a time with SSE2 where the compiler targets it and fall back to scalar code elsewhere.
+ * Case folding only affects 'A' to 'Z' which matches tolower and strcasecmp in the C locale the game runs in.
+ */
+namespace rts
+{
+bool Has_Upper_Ascii(const char *s, int len);
+void To_Lower_Ascii(char *s, int len);
+int Compare_No_Case(const char *left, const char *right);
+int Compare_No_Case(const char *left, const char *right, int count);
+bool Is_Ascii(const char *s, int len);
+bool Is_Ascii(const unichar_t *s, int len);
+void Widen_Ascii(unichar_t *dst, const char *src, int len);
+void Narrow_Ascii(char *dst, const unichar_t *src, int len);
+int Clean_Line(char *s, int len, char comment);
+} // namespace rts
@@ -15,6 +15,7 @@
 #include "unicodestring.h"
 #include "asciistring.h"
 #include "critsection.h"
+#include "stringsimd.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -218,13 +219,31 @@ void Utf16String::Translate(const char *string)
 {
     Release_Buffer();
 
+    // Most strings are plain ASCII which converts one byte to one character.
+    int ascii_len = string != nullptr ? strlen(string) : 0;
+
+    if (ascii_len == 0) {
+        return;
+    }
+
+    if (rts::Is_Ascii(string, ascii_len)) {
+        unichar_t *dst = Get_Buffer_For_Read(ascii_len);
+        rts::Widen_Ascii(dst, string, ascii_len);
+        dst[ascii_len] = (unichar_t)u'\0';
+
+        return;
+    }
+
 #if defined BUILD_WITH_ICU // Use ICU convertors
     int32_t length;
     UErrorCode error = U_ZERO_ERROR;
     u_strFromUTF8(nullptr, 0, &length, string, -1, &error);
 
-    if (U_SUCCESS(error) && length > 0) {
-        u_strFromUTF8(Get_Buffer_For_Read(length), length, nullptr, string, -1, &error);
+    // Preflighting without a buffer reports an overflow but still gives the needed length.
+    if ((U_SUCCESS(error) || error == U_BUFFER_OVERFLOW_ERROR) && length > 0) {
+        error = U_ZERO_ERROR;
+        // Capacity includes the terminator so ICU null terminates the result.
+        u_strFromUTF8(Get_Buffer_For_Read(length), length + 1, nullptr, string, -1, &error);
 
         if (U_FAILURE(error)) {
             Clear();
@@ -14,6 +14,7 @@
  */
 #include "userpreferences.h"
 #include "globaldata.h"
+#include "numberscan.h"
 #include <cstdio>
 
 UserPreferences::UserPreferences()
@@ -94,7 +95,9 @@ int UserPreferences::Get_Int(Utf8String key, int def_arg)
         return def_arg;
     }
 
-    return atoi(value.Str());
+    int32_t result;
+
+    return rts::Scan_Int32(value.Str(), result) != nullptr ? result : 0;
 }
 
 float UserPreferences::Get_Real(Utf8String key, float def_arg)
@@ -105,7 +108,9 @@ float UserPreferences::Get_Real(Utf8String key, float def_arg)
         return def_arg;
     }
 
-    return (float)atof(value.Str());
+    float result;
+
+    return rts::Scan_Float(value.Str(), result) != nullptr ? result : 0.0f;
 }
 
 bool UserPreferences::Get_Bool(Utf8String key, bool def_arg)
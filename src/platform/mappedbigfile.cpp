@@ -0,0 +1,114 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief BIG archive read through a memory mapping of the whole archive.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "mappedbigfile.h"
+#include "mappedarchivefile.h"
+#include <captainslog.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedBIGFile::~MappedBIGFile()
+{
+    Unmap();
+}
+
+File *MappedBIGFile::Open_File(const char *filename, int mode)
+{
+    if ((mode & File::WRITE) != 0) {
+        return Win32BIGFile::Open_File(filename, mode);
+    }
+
+    ArchivedFileInfo *arch_info = Get_Archived_File_Info(filename);
+
+    if (arch_info == nullptr) {
+        captainslog_trace("Couldn't find info for the requested file.");
+        return nullptr;
+    }
+
+    if (arch_info->position < 0 || arch_info->size < 0
+        || size_t(arch_info->position) + size_t(arch_info->size) > m_mappingSize) {
+        captainslog_error("'%s' lies outside of its archive.", filename);
+        return nullptr;
+    }
+
+    MappedArchiveFile *file = new MappedArchiveFile;
+    file->Set_Del_On_Close(true);
+
+    if (!file->Open_View(arch_info->file_name, m_mapping + arch_info->position, arch_info->size)) {
+        file->Close();
+
+        return nullptr;
+    }
+
+    return file;
+}
+
+/**
+ * Maps an archive into memory, returns a view of the whole archive to read the header from and to attach as the
+ * backing file or nullptr if it couldn't be mapped.
+ */
+File *MappedBIGFile::Map(const char *filename)
+{
+    Unmap();
+
+    int fd = open(filename, O_RDONLY);
+
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat info;
+    void *mapping = MAP_FAILED;
+
+    if (fstat(fd, &info) == 0 && info.st_size > 0 && info.st_size <= INT32_MAX) {
+        mapping = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    // The mapping keeps the file alive on its own.
+    close(fd);
+
+    if (mapping == MAP_FAILED) {
+        captainslog_trace("Couldn't map archive file '%s'.", filename);
+        return nullptr;
+    }
+
+    m_mapping = static_cast<const uint8_t *>(mapping);
+    m_mappingSize = size_t(info.st_size);
+
+    MappedArchiveFile *file = new MappedArchiveFile;
+    file->Set_Del_On_Close(true);
+
+    if (!file->Open_View(filename, m_mapping, int(m_mappingSize))) {
+        file->Close();
+        Unmap();
+
+        return nullptr;
+    }
+
+    return file;
+}
+
+void MappedBIGFile::Unmap()
+{
+    // The backing file is a view of the mapping so has to go first.
+    Attach_File(nullptr);
+
+    if (m_mapping != nullptr) {
+        munmap(const_cast<uint8_t *>(m_mapping), m_mappingSize);
+        m_mapping = nullptr;
+        m_mappingSize = 0;
+    }
+}
@@ -0,0 +1,39 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief BIG archive read through a memory mapping of the whole archive.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#pragma once
+
+#include "win32bigfile.h"
+
+/**
+ * Files opened for reading are views into the mapping so opening one costs no system calls or copies and
+ * File::Peek_Data lends out the contents directly. Writing still goes through Win32BIGFile.
+ */
+class MappedBIGFile : public Win32BIGFile
+{
+public:
+    MappedBIGFile() : m_mapping(nullptr), m_mappingSize(0) {}
+    virtual ~MappedBIGFile();
+
+    virtual File *Open_File(const char *filename, int mode) override;
+
+    File *Map(const char *filename);
+
+private:
+    void Unmap();
+
+private:
+    const uint8_t *m_mapping;
+    size_t m_mappingSize;
+};
@@ -21,13 +21,65 @@
 #include "registry.h"
 #include "rtsutils.h"
 #include "win32bigfile.h"
+#include "win32localfile.h"
+#include <algorithm>
+#include <vector>
+
+#ifndef GAME_DLL
+#include <atomic>
+#include <thread>
+#endif
+
+#ifdef BUILD_WITH_MMAP
+#include "mappedarchivefile.h"
+#include "mappedbigfile.h"
+#endif
 
 using rts::FourCC;
 
+namespace
+{
+#ifndef GAME_DLL
+// Lives next to the archives, the user data directory isn't known yet when archives are loaded.
+const char s_indexCacheName[] = "ArchiveIndex.cache";
+#endif
+
+/**
+ * Splits a path from an archive header into its directory and file name and adds it to the archive, the path buffer
+ * is modified in the process.
+ */
+void Add_Archived_File(Win32BIGFile *big, ArchivedFileInfo *info, char *namebuf, int length)
+{
+    // Find the start of the file name
+    int name_start = length;
+
+    for (; name_start >= 0; --name_start) {
+        if (namebuf[name_start] == '\\' || namebuf[name_start] == '/') {
+            break;
+        }
+    }
+
+    // Store the file name in the info struct and then null first char so we
+    // can recover the rest of the path.
+    info->file_name = &namebuf[name_start + 1];
+    info->file_name.To_Lower();
+    // captainslog_trace("Base name is '%s'.", &namebuf[name_start + 1]);
+
+    namebuf[name_start + 1] = '\0';
+
+    // captainslog_trace("Path is '%s'.", namebuf);
+
+    big->Add_File(namebuf, info);
+}
+} // namespace
+
 void Win32BIGFileSystem::Init()
 {
     captainslog_trace("Initialising BIG file system.");
     if (g_theLocalFileSystem != nullptr) {
+#ifndef GAME_DLL
+        m_indexCache.Load(s_indexCacheName);
+#endif
         Load_Archives_From_Dir("", "*.big", false);
 
         Utf8String gen_path;
@@ -48,18 +100,66 @@ ArchiveFile *Win32BIGFileSystem::Open_Archive_File(const char *filename)
 
     captainslog_trace("Win32BigFileSystem::Open_Archive_File - opening BIG file %s.", filename);
 
-    File *file = g_theLocalFileSystem->Open_File(filename, File::READ | File::BINARY);
-    Win32BIGFile *big = new Win32BIGFile;
+    File *file = nullptr;
+    Win32BIGFile *big = nullptr;
+
+#ifdef BUILD_WITH_MMAP
+    // Mapped archives hand out views of the archive rather than copies, fall back to reading if mapping fails.
+    MappedBIGFile *mapped = new MappedBIGFile;
+    file = mapped->Map(filename);
+
+    if (file != nullptr) {
+        big = mapped;
+    } else {
+        delete mapped;
+    }
+#endif
+
+    if (file == nullptr) {
+        file = g_theLocalFileSystem->Open_File(filename, File::READ | File::BINARY);
+        big = new Win32BIGFile;
+    }
 
     Utf8String fullname = filename;
     fullname.To_Lower();
 
     if (file == nullptr) {
         captainslog_trace("Couldn't open local archive file '%s'.", filename);
+        delete big;
 
         return nullptr;
     }
 
+    ArchivedFileInfo *info = new ArchivedFileInfo;
+    info->archive_name = filename;
+
+#ifndef GAME_DLL
+    // An unchanged archive can be filled in from the index cache without reading its header at all.
+    FileInfo file_info;
+    bool cacheable = g_theLocalFileSystem->Get_File_Info(filename, &file_info);
+    ArchiveIndexCache::Entry const *cached_entries;
+    const char *cached_names;
+    int cached_count;
+
+    if (cacheable && m_indexCache.Find(filename, file_info, cached_entries, cached_names, cached_count)) {
+        for (int i = 0; i < cached_count; ++i) {
+            char namebuf[BIG_PATH_MAX];
+            strlcpy(namebuf, cached_names + cached_entries[i].name, sizeof(namebuf));
+            info->position = cached_entries[i].position;
+            info->size = cached_entries[i].size;
+            Add_Archived_File(big, info, namebuf, int(strlen(namebuf)));
+        }
+
+        big->Attach_File(file);
+        delete info;
+
+        return big;
+    }
+
+    std::vector<ArchiveIndexCache::Entry> entries;
+    std::vector<char> names;
+#endif
+
     // Read and check Big file FourCC, make sure we opened the right thing.
     // BIGF is used in Generals games, BIG4 is used in BFME games.
     file->Read(&idbuff, sizeof(idbuff));
@@ -67,6 +167,8 @@ ArchiveFile *Win32BIGFileSystem::Open_Archive_File(const char *filename)
     if (idbuff != FourCC<'B', 'I', 'G', 'F'>::value && idbuff != FourCC<'B', 'I', 'G', '4'>::value) {
         captainslog_error("Opened file '%s' does not have correct Big File FourCC, closing.", filename);
         file->Close();
+        delete info;
+        delete big;
 
         return nullptr;
     }
@@ -87,8 +189,6 @@ ArchiveFile *Win32BIGFileSystem::Open_Archive_File(const char *filename)
     // Seek to first file information
     file->Seek(16, File::START);
 
-    ArchivedFileInfo *info = new ArchivedFileInfo;
-
     // Process each file info found in the Big file header.
     for (unsigned int i = 0; i < file_count; ++i) {
         int32_t file_size = 0;
@@ -103,7 +203,6 @@ ArchiveFile *Win32BIGFileSystem::Open_Archive_File(const char *filename)
 
         info->size = file_size;
         info->position = file_pos;
-        info->archive_name = filename;
 
         int strlen = 0;
         char *putp = namebuf;
@@ -122,29 +221,20 @@ ArchiveFile *Win32BIGFileSystem::Open_Archive_File(const char *filename)
 
         // captainslog_trace("Recovered a file path of '%s' with size '%d' and position '%d'.", namebuf, file_size, file_pos);
 
-        // Find the start of the file name
-        int name_start = strlen;
+#ifndef GAME_DLL
+        ArchiveIndexCache::Entry entry = { file_pos, file_size, uint32_t(names.size()) };
+        entries.push_back(entry);
+        names.insert(names.end(), namebuf, namebuf + strlen + 1);
+#endif
 
-        for (; name_start >= 0; --name_start) {
-            if (namebuf[name_start] == '\\' || namebuf[name_start] == '/') {
-                break;
-            }
-        }
-
-        // Store the file name in the info struct and then null first char so we
-        // can recover the rest of the path.
-        info->file_name = &namebuf[name_start + 1];
-        info->file_name.To_Lower();
-        // captainslog_trace("Base name is '%s'.", &namebuf[name_start + 1]);
-
-        namebuf[name_start + 1] = '\0';
-
-        // captainslog_trace("Path is '%s'.", namebuf);
+        Add_Archived_File(big, info, namebuf, strlen);
+    }
 
-        Utf8String file_path = namebuf;
-        file_path += info->file_name;
-        big->Add_File(namebuf, info);
+#ifndef GAME_DLL
+    if (cacheable) {
+        m_indexCache.Add_Archive(filename, file_info, entries, names);
     }
+#endif
 
     big->Attach_File(file);
 
@@ -166,6 +256,9 @@ void Win32BIGFileSystem::Close_Archive_File(const char *filename)
         }
 
         if (it->second != nullptr) {
+#ifndef GAME_DLL
+            Remove_From_Dir_Tree(it->second);
+#endif
             delete it->second;
         }
 
@@ -179,6 +272,76 @@ void Win32BIGFileSystem::Load_Archives_From_Dir(Utf8String dir, Utf8String filte
 
     g_theLocalFileSystem->Get_File_List_From_Dir(dir, "", filter, file_list, read_subdirs);
 
+#ifndef GAME_DLL
+    // Headers are read on worker threads, only adding the archives to the file system has to follow the search order.
+    std::vector<Utf8String> names(file_list.begin(), file_list.end());
+    std::vector<ArchiveFile *> archives(names.size(), nullptr);
+    std::atomic<int> next_archive(0);
+#if LOGGING_LEVEL >= LOGLEVEL_INFO
+    std::vector<unsigned> open_times(names.size(), 0);
+    unsigned start_time = rts::Get_Time();
+#endif
+
+    auto worker = [&]() {
+        for (int i = next_archive++; i < int(names.size()); i = next_archive++) {
+#if LOGGING_LEVEL >= LOGLEVEL_INFO
+            unsigned open_start = rts::Get_Time();
+            archives[i] = Open_Archive_File(names[i].Str());
+            open_times[i] = rts::Get_Time() - open_start;
+#else
+            archives[i] = Open_Archive_File(names[i].Str());
+#endif
+        }
+    };
+
+    // Pools are created lazily without locking, so everything the workers allocate from is created here first.
+    Win32LocalFile::Create_Class_Pool();
+#ifdef BUILD_WITH_MMAP
+    MappedArchiveFile::Create_Class_Pool();
+#endif
+
+    int threads = std::min({ int(std::thread::hardware_concurrency()), int(names.size()), int(LOAD_THREADS_MAX) });
+    std::vector<std::thread> pool;
+
+    for (int i = 1; i < threads; ++i) {
+        pool.emplace_back(worker);
+    }
+
+    worker();
+
+    for (std::thread &thread : pool) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (archives[i] != nullptr) {
+#if LOGGING_LEVEL >= LOGLEVEL_INFO
+            unsigned merge_start = rts::Get_Time();
+#endif
+            Load_Into_Dir_Tree(archives[i], names[i], read_subdirs);
+            m_archiveFiles[names[i]] = archives[i];
+
+#if LOGGING_LEVEL >= LOGLEVEL_INFO
+            captainslog_info("Loaded archive '%s', opening took %u ms and indexing %u ms.",
+                names[i].Str(),
+                open_times[i],
+                rts::Get_Time() - merge_start);
+#endif
+        }
+    }
+
+#if LOGGING_LEVEL >= LOGLEVEL_INFO
+    captainslog_info("Loaded %d archives from '%s' in %u ms with %d threads.",
+        int(names.size()),
+        dir.Str(),
+        rts::Get_Time() - start_time,
+        std::max(threads, 1));
+#endif
+
+    if (m_indexCache.Is_Dirty()) {
+        m_indexCache.Save(s_indexCacheName);
+    }
+#else
     for (auto it = file_list.begin(); it != file_list.end(); ++it) {
         captainslog_trace("Win32BIGFileSystem::Load_Archives_From_Dir - loading %s into the directory tree.", (*it).Str());
         ArchiveFile *arch = Open_Archive_File((*it).Str());
@@ -190,4 +353,5 @@ void Win32BIGFileSystem::Load_Archives_From_Dir(Utf8String dir, Utf8String filte
             captainslog_trace("Win32BIGFileSystem::Load_Archives_From_Dir - %s inserted into the archive file map.", (*it).Str());
         }
     }
+#endif
 }
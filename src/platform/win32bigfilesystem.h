@@ -16,11 +16,16 @@
 
 #include "archivefilesystem.h"
 
+#ifndef GAME_DLL
+#include "archiveindexcache.h"
+#endif
+
 class Win32BIGFileSystem : public ArchiveFileSystem
 {
     enum
     {
         BIG_PATH_MAX = 260,
+        LOAD_THREADS_MAX = 8, // Reading headers is mostly waiting on the disk so more threads stop helping quickly.
     };
 public:
     Win32BIGFileSystem() {}
@@ -37,4 +42,9 @@ public:
     virtual void Close_All_Archives() override {}
     virtual void Close_All_Files() override {}
     virtual void Load_Archives_From_Dir(Utf8String dir, Utf8String filter, bool read_subdirs) override;
+
+#ifndef GAME_DLL
+private:
+    ArchiveIndexCache m_indexCache;
+#endif
 };
\ No newline at end of file
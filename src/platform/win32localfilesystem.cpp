@@ -27,6 +27,155 @@
 #include <unistd.h>
 #endif
 
+#ifdef BUILD_WITH_INOTIFY
+#include <errno.h>
+#include <sys/inotify.h>
+#endif
+
+#ifndef GAME_DLL
+Win32LocalFileSystem::Win32LocalFileSystem()
+{
+    captainslog_trace("Creating Win32LocalFileSystem.");
+#if defined BUILD_WITH_INOTIFY
+    m_watchFd = -1;
+#elif defined PLATFORM_WINDOWS
+    m_changeHandle = INVALID_HANDLE_VALUE;
+#endif
+}
+
+Win32LocalFileSystem::~Win32LocalFileSystem()
+{
+#if defined BUILD_WITH_INOTIFY
+    if (m_watchFd >= 0) {
+        close(m_watchFd);
+    }
+#elif defined PLATFORM_WINDOWS
+    if (m_changeHandle != INVALID_HANDLE_VALUE) {
+        FindCloseChangeNotification(m_changeHandle);
+    }
+#endif
+}
+
+/**
+ * Starts watching for files being added or removed behind our back so lookups cached on top of this file system can
+ * be dropped. Changes made through this file system are accounted for without the watch.
+ */
+void Win32LocalFileSystem::Init()
+{
+    // Files are opened from the prefetch and loading threads, the pool has to exist before any of them start.
+    Win32LocalFile::Create_Class_Pool();
+
+#if defined BUILD_WITH_INOTIFY
+    if (m_watchFd < 0) {
+        m_watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        captainslog_dbgassert(m_watchFd >= 0, "Failed to start watching the game directory for changes.");
+        Watch_Directory("");
+    }
+#elif defined PLATFORM_WINDOWS
+    if (m_changeHandle == INVALID_HANDLE_VALUE) {
+        m_changeHandle =
+            FindFirstChangeNotificationW(L".", TRUE, FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME);
+        captainslog_dbgassert(
+            m_changeHandle != INVALID_HANDLE_VALUE, "Failed to start watching the game directory for changes.");
+    }
+#endif
+}
+
+void Win32LocalFileSystem::Update()
+{
+#if defined BUILD_WITH_INOTIFY
+    if (m_watchFd < 0) {
+        return;
+    }
+
+    alignas(inotify_event) char buffer[4096];
+    bool changed = false;
+    ssize_t length;
+
+    while ((length = read(m_watchFd, buffer, sizeof(buffer))) > 0) {
+        for (char *pos = buffer; pos < buffer + length;) {
+            inotify_event *event = reinterpret_cast<inotify_event *>(pos);
+            pos += sizeof(inotify_event) + event->len;
+
+            // Watches are dropped by the kernel once their directory goes away.
+            if ((event->mask & IN_IGNORED) != 0) {
+                auto it = m_watches.find(event->wd);
+
+                if (it != m_watches.end()) {
+                    m_watchedDirs.erase(it->second);
+                    m_watches.erase(it);
+                }
+            } else {
+                changed = true;
+            }
+        }
+    }
+
+    if (changed) {
+        ++m_generation;
+    }
+#elif defined PLATFORM_WINDOWS
+    if (m_changeHandle == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    if (WaitForSingleObject(m_changeHandle, 0) == WAIT_OBJECT_0) {
+        ++m_generation;
+        FindNextChangeNotification(m_changeHandle);
+    }
+#endif
+}
+
+/**
+ * @brief Watches the directory a file would be in, or the closest parent that exists so the directory being created
+ * is noticed. Windows watches the whole tree from the start so this is only needed for inotify.
+ */
+void Win32LocalFileSystem::Watch_Directory(const char *filename)
+{
+#ifdef BUILD_WITH_INOTIFY
+    if (m_watchFd < 0) {
+        return;
+    }
+
+    // Only forward slashes separate directories here, backslashes are part of the name.
+    char dir[PATH_MAX];
+    strlcpy(dir, filename, sizeof(dir));
+    char *end = strrchr(dir, '/');
+
+    if (end == nullptr) {
+        end = dir;
+    }
+
+    *end = '\0';
+
+    while (true) {
+        const char *path = *dir != '\0' ? dir : ".";
+
+        if (m_watchedDirs.find(path) != m_watchedDirs.end()) {
+            return;
+        }
+
+        int wd = inotify_add_watch(m_watchFd,
+            path,
+            IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+
+        if (wd >= 0) {
+            m_watches[wd] = path;
+            m_watchedDirs.insert(path);
+            return;
+        }
+
+        if ((errno != ENOENT && errno != ENOTDIR) || *dir == '\0') {
+            return;
+        }
+
+        end = strrchr(dir, '/');
+        *(end != nullptr ? end : dir) = '\0';
+    }
+#endif
+}
+#endif
+
 File *Win32LocalFileSystem::Open_File(const char *filename, int mode)
 {
     if (strlen(filename) <= 0) {
@@ -54,9 +203,20 @@ File *Win32LocalFileSystem::Open_File(const char *filename, int mode)
         }
     }
 
+#ifndef GAME_DLL
+    // Only a file being created changes which files exist, writing to one that is already there doesn't.
+    bool created = (mode & File::WRITE) != 0 && access(filename, 0) != 0;
+#endif
+
     // Try and open the file, if not, delete instance and return null.
     if (file->Open(filename, mode)) {
         file->Set_Del_On_Close(true);
+
+#ifndef GAME_DLL
+        if (created) {
+            ++m_generation;
+        }
+#endif
     } else {
         Delete_Instance(file);
         file = nullptr;
@@ -67,6 +227,11 @@ File *Win32LocalFileSystem::Open_File(const char *filename, int mode)
 
 bool Win32LocalFileSystem::Does_File_Exist(const char *filename)
 {
+#ifndef GAME_DLL
+    // Callers may cache the answer, so make sure they hear about the file turning up or going away.
+    Watch_Directory(filename);
+#endif
+
     return access(filename, 0) == 0;
 }
 
@@ -180,8 +345,16 @@ bool Win32LocalFileSystem::Create_Directory(Utf8String dir_path)
 
     // So much for mkdir being more cross platform
 #ifdef PLATFORM_WINDOWS
-    return CreateDirectoryW(UTF8To16(dir_path), nullptr) != 0;
+    bool created = CreateDirectoryW(UTF8To16(dir_path), nullptr) != 0;
 #else
-    return mkdir(dir_path, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) == 0;
+    bool created = mkdir(dir_path, S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH) == 0;
 #endif
+
+#ifndef GAME_DLL
+    if (created) {
+        ++m_generation;
+    }
+#endif
+
+    return created;
 }
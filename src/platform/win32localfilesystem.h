@@ -17,10 +17,13 @@
 #include "localfilesystem.h"
 #include "win32localfile.h"
 #include <captainslog.h>
+#include <map>
+#include <set>
 
 class Win32LocalFileSystem : public LocalFileSystem
 {
 public:
+#ifdef GAME_DLL
     Win32LocalFileSystem() { captainslog_trace("Creating Win32LocalFileSystem."); }
     virtual ~Win32LocalFileSystem() {}
 
@@ -28,6 +31,15 @@ public:
     virtual void Init() override {}
     virtual void Reset() override {}
     virtual void Update() override {}
+#else
+    Win32LocalFileSystem();
+    virtual ~Win32LocalFileSystem();
+
+    // Subsystem interface implementations.
+    virtual void Init() override;
+    virtual void Reset() override {}
+    virtual void Update() override;
+#endif
 
     // LocalFileSystem interface implementations.
     virtual File *Open_File(const char *filename, int mode) override;
@@ -36,4 +48,18 @@ public:
         std::set<Utf8String, rts::less_than_nocase<Utf8String>> &filelist, bool search_subdirs) override;
     virtual bool Get_File_Info(Utf8String const &filename, FileInfo *info) override;
     virtual bool Create_Directory(Utf8String dir_path) override;
+
+#ifndef GAME_DLL
+private:
+    void Watch_Directory(const char *filename);
+
+private:
+#if defined BUILD_WITH_INOTIFY
+    int m_watchFd;
+    std::map<int, Utf8String> m_watches; // Watched directories keyed by watch descriptor.
+    std::set<Utf8String> m_watchedDirs;
+#elif defined PLATFORM_WINDOWS
+    HANDLE m_changeHandle; // Watches the whole game directory tree.
+#endif
+#endif
 };
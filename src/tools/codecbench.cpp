@@ -0,0 +1,475 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Measures the speed and compression ratio of the CompressionManager codecs on a corpus of files.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "compressionmanager.h"
+#include "refpack.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+using std::atoi;
+using std::fclose;
+using std::fopen;
+using std::fread;
+using std::memcmp;
+using std::printf;
+using std::strcmp;
+using std::tolower;
+
+namespace
+{
+struct CodecStats
+{
+    int64_t files;
+    int64_t failures;
+    int64_t raw_bytes;
+    int64_t compressed_bytes;
+    double compress_seconds;
+    double decompress_seconds;
+};
+
+struct RefPackStats
+{
+    int64_t bytes;
+    double baseline_seconds;
+    double unchecked_seconds;
+    double checked_seconds;
+};
+
+const CompressionType s_benchCodecs[] = {
+    COMPRESSION_EAR,
+#ifdef BUILD_WITH_ZLIB
+    COMPRESSION_ZL1,
+    COMPRESSION_ZL5,
+    COMPRESSION_ZL9,
+#endif
+};
+
+const int s_benchCodecCount = sizeof(s_benchCodecs) / sizeof(s_benchCodecs[0]);
+
+const char *Codec_Tag(CompressionType type)
+{
+    static const char *tags[COMPRESSION_COUNT] = {
+        "none", "EAR", "NOX", "ZL1", "ZL2", "ZL3", "ZL4", "ZL5", "ZL6", "ZL7", "ZL8", "ZL9", "EAB", "EAH"
+    };
+
+    return tags[type];
+}
+
+bool Load_File(const char *filename, std::vector<uint8_t> &data)
+{
+    FILE *fp = fopen(filename, "rb");
+
+    if (fp == nullptr) {
+        printf("Failed to open '%s'.\n", filename);
+
+        return false;
+    }
+
+    uint8_t buffer[64 * 1024];
+    size_t read;
+
+    while ((read = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        data.insert(data.end(), buffer, buffer + read);
+    }
+
+    fclose(fp);
+
+    return true;
+}
+
+/**
+ * @brief Files are grouped by extension, so maps and saves each get their own results.
+ */
+std::string Asset_Type(const char *filename)
+{
+    const char *dot = nullptr;
+
+    for (const char *c = filename; *c != '\0'; ++c) {
+        if (*c == '.') {
+            dot = c;
+        } else if (*c == '/' || *c == '\\') {
+            dot = nullptr;
+        }
+    }
+
+    if (dot == nullptr) {
+        return "(none)";
+    }
+
+    std::string type(dot);
+    std::transform(type.begin(), type.end(), type.begin(), [](char c) { return char(tolower(c)); });
+
+    return type;
+}
+
+/**
+ * @brief Compresses and decompresses a file with one codec, keeping the best time of several runs.
+ */
+void Bench_Codec(CompressionType type, std::vector<uint8_t> &data, int repeats, int threads, CodecStats &stats)
+{
+    int size = int(data.size());
+    std::vector<uint8_t> compressed(CompressionManager::Get_Max_Compressed_Size(size, type));
+    std::vector<uint8_t> decompressed(size);
+    double best_compress = 0.0;
+    double best_decompress = 0.0;
+    int compressed_size = 0;
+    bool ok = true;
+
+    for (int i = 0; i < repeats && ok; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        compressed_size = CompressionManager::Compress_Data(
+            type, data.data(), size, compressed.data(), int(compressed.size()), threads);
+        auto middle = std::chrono::steady_clock::now();
+        int decompressed_size = CompressionManager::Decompress_Data(
+            compressed.data(), compressed_size, decompressed.data(), int(decompressed.size()));
+        auto end = std::chrono::steady_clock::now();
+
+        ok = compressed_size > 0 && decompressed_size == size && memcmp(decompressed.data(), data.data(), size) == 0;
+
+        double compress_time = std::chrono::duration<double>(middle - start).count();
+        double decompress_time = std::chrono::duration<double>(end - middle).count();
+
+        if (i == 0 || compress_time < best_compress) {
+            best_compress = compress_time;
+        }
+
+        if (i == 0 || decompress_time < best_decompress) {
+            best_decompress = decompress_time;
+        }
+    }
+
+    ++stats.files;
+
+    if (!ok) {
+        ++stats.failures;
+        return;
+    }
+
+    stats.raw_bytes += size;
+    stats.compressed_bytes += compressed_size;
+    stats.compress_seconds += best_compress;
+    stats.decompress_seconds += best_decompress;
+}
+
+/**
+ * @brief The byte at a time RefPack decoder RefPack_Uncompress replaced, kept as the baseline it is measured against.
+ */
+int Baseline_RefPack_Uncompress(void *dst, const void *src, int *size)
+{
+    const uint8_t *getp;
+    uint8_t *ref;
+    uint8_t *putp;
+    uint8_t first;
+    uint8_t second;
+    uint8_t third;
+    uint8_t forth;
+    uint16_t flags;
+    uint32_t run;
+    int out_length = 0;
+
+    if (src == nullptr) {
+        if (size != nullptr) {
+            *size = 0;
+        }
+
+        return 0;
+    }
+
+    getp = static_cast<const uint8_t *>(src);
+
+    // This flag and size reading section appears to differe between different RefPack versions.
+    flags = (getp[0] << 8) | getp[1];
+    getp += 2;
+
+    if (flags & 0x8000) {
+        if (flags & 0x0100) {
+            getp += 6;
+        }
+
+        out_length = (getp[0] << 24) | (getp[1] << 16) | (getp[2] << 8) | getp[3];
+        getp += 4;
+    } else {
+        if (flags & 0x0100) {
+            getp += 5;
+        }
+
+        out_length = (getp[0] << 16) | (getp[1] << 8) | getp[2];
+        getp += 3;
+    }
+
+    putp = static_cast<uint8_t *>(dst);
+
+    while (true) {
+        first = *getp++;
+
+        // Short command.
+        if (!(first & 0x80)) {
+            second = *getp++;
+            run = first & 3;
+
+            while (run--) {
+                *putp++ = *getp++;
+            }
+
+            ref = putp - 1 - (((first & 0x60) << 3) + second);
+            run = ((first & 0x1c) >> 2) + 3 - 1;
+
+            do {
+                *putp++ = *ref++;
+            } while (run--);
+
+            continue;
+        }
+
+        // Medium command.
+        if (!(first & 0x40)) {
+            second = *getp++;
+            third = *getp++;
+            run = second >> 6;
+
+            while (run--) {
+                *putp++ = *getp++;
+            }
+
+            ref = putp - 1 - (((second & 0x3f) << 8) + third);
+
+            run = (first & 0x3f) + 4 - 1;
+
+            do {
+                *putp++ = *ref++;
+            } while (run--);
+
+            continue;
+        }
+
+        // Long command.
+        if (!(first & 0x20)) {
+            second = *getp++;
+            third = *getp++;
+            forth = *getp++;
+            run = first & 3;
+
+            while (run--) {
+                *putp++ = *getp++;
+            }
+
+            ref = putp - 1 - (((first & 0x10) >> 4 << 16) + (second << 8) + third);
+
+            run = ((first & 0x0c) >> 2 << 8) + forth + 5 - 1;
+
+            do {
+                *putp++ = *ref++;
+            } while (run--);
+
+            continue;
+        }
+
+        // Byte command.
+        run = ((first & 0x1f) << 2) + 4;
+
+        if (run <= 112) {
+            while (run--) {
+                *putp++ = *getp++;
+            }
+
+            continue;
+        }
+
+        // End marker and possibly run of up to 3 bytes.
+        run = first & 3;
+
+        while (run--) {
+            *putp++ = *getp++;
+        }
+
+        break;
+    }
+
+    if (size != nullptr) {
+        *size = getp - static_cast<const uint8_t *>(src);
+    }
+
+    return out_length;
+}
+
+/**
+ * @brief Times the baseline, unchecked and bounds checked RefPack decoders, returns false if any of them decoded the
+ * data wrongly.
+ */
+bool Bench_RefPack_Decoders(std::vector<uint8_t> &data, int repeats, RefPackStats &stats)
+{
+    int size = int(data.size());
+    std::vector<uint8_t> compressed(RefPack_Max_Compressed_Size(size));
+    int compressed_size = RefPack_Compress(compressed.data(), data.data(), size, false);
+    std::vector<uint8_t> decompressed[3] = {
+        std::vector<uint8_t>(size), std::vector<uint8_t>(size), std::vector<uint8_t>(size)
+    };
+    double best[3] = {};
+
+    for (int i = 0; i < repeats; ++i) {
+        double times[3];
+        int used;
+        auto start = std::chrono::steady_clock::now();
+        Baseline_RefPack_Uncompress(decompressed[0].data(), compressed.data(), &used);
+        auto baseline_end = std::chrono::steady_clock::now();
+        RefPack_Uncompress(decompressed[1].data(), compressed.data(), &used);
+        auto unchecked_end = std::chrono::steady_clock::now();
+        RefPack_Uncompress_Checked(decompressed[2].data(), size, compressed.data(), compressed_size);
+        auto checked_end = std::chrono::steady_clock::now();
+
+        times[0] = std::chrono::duration<double>(baseline_end - start).count();
+        times[1] = std::chrono::duration<double>(unchecked_end - baseline_end).count();
+        times[2] = std::chrono::duration<double>(checked_end - unchecked_end).count();
+
+        for (int j = 0; j < 3; ++j) {
+            if (i == 0 || times[j] < best[j]) {
+                best[j] = times[j];
+            }
+        }
+    }
+
+    stats.bytes += size;
+    stats.baseline_seconds += best[0];
+    stats.unchecked_seconds += best[1];
+    stats.checked_seconds += best[2];
+
+    for (std::vector<uint8_t> &output : decompressed) {
+        if (memcmp(output.data(), data.data(), size) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Print_Stats(const char *group, CompressionType type, const CodecStats &stats)
+{
+    double megabytes = double(stats.raw_bytes) / (1024.0 * 1024.0);
+
+    printf("%-10s %-4s %6lld %12lld %12lld %7.3f %10.1f %10.1f %s\n",
+        group,
+        Codec_Tag(type),
+        (long long)stats.files,
+        (long long)stats.raw_bytes,
+        (long long)stats.compressed_bytes,
+        stats.raw_bytes > 0 ? double(stats.compressed_bytes) / stats.raw_bytes : 0.0,
+        stats.compress_seconds > 0.0 ? megabytes / stats.compress_seconds : 0.0,
+        stats.decompress_seconds > 0.0 ? megabytes / stats.decompress_seconds : 0.0,
+        stats.failures != 0 ? "ROUND TRIP FAILED" : "");
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int repeats = 3;
+    int threads = 1;
+    int first_file = 1;
+
+    for (; first_file + 1 < argc; first_file += 2) {
+        if (strcmp(argv[first_file], "-r") == 0) {
+            repeats = std::max(1, atoi(argv[first_file + 1]));
+        } else if (strcmp(argv[first_file], "-t") == 0) {
+            threads = std::max(1, atoi(argv[first_file + 1]));
+        } else {
+            break;
+        }
+    }
+
+    if (first_file >= argc) {
+        printf("Usage: %s [-r repeat count] [-t compression threads] <file> [file...]\n", argv[0]);
+
+        return 1;
+    }
+
+    // Results keyed by asset type then codec, the empty type holds the totals.
+    std::map<std::string, std::map<int, CodecStats>> results;
+    RefPackStats refpack = {};
+    bool failed = false;
+
+    for (int i = first_file; i < argc; ++i) {
+        std::vector<uint8_t> data;
+
+        if (!Load_File(argv[i], data) || data.empty()) {
+            continue;
+        }
+
+        // Already compressed files are measured on their contents.
+        if (CompressionManager::Is_Data_Compressed(data.data(), int(data.size()))) {
+            std::vector<uint8_t> raw(CompressionManager::Get_Uncompressed_Size(data.data(), int(data.size())));
+
+            if (CompressionManager::Decompress_Data(data.data(), int(data.size()), raw.data(), int(raw.size()))
+                != int(raw.size())) {
+                printf("Skipping '%s', it could not be decompressed.\n", argv[i]);
+                continue;
+            }
+
+            data.swap(raw);
+        }
+
+        std::string type = Asset_Type(argv[i]);
+
+        for (int j = 0; j < s_benchCodecCount; ++j) {
+            CodecStats stats = {};
+            Bench_Codec(s_benchCodecs[j], data, repeats, threads, stats);
+
+            for (CodecStats *total : { &results[type][j], &results[""][j] }) {
+                total->files += stats.files;
+                total->failures += stats.failures;
+                total->raw_bytes += stats.raw_bytes;
+                total->compressed_bytes += stats.compressed_bytes;
+                total->compress_seconds += stats.compress_seconds;
+                total->decompress_seconds += stats.decompress_seconds;
+            }
+        }
+
+        if (!Bench_RefPack_Decoders(data, repeats, refpack)) {
+            printf("RefPack decoders disagree on '%s'.\n", argv[i]);
+            failed = true;
+        }
+    }
+
+    printf("%-10s %-4s %6s %12s %12s %7s %10s %10s\n",
+        "Type",
+        "Codec",
+        "Files",
+        "Raw bytes",
+        "Packed bytes",
+        "Ratio",
+        "Comp MB/s",
+        "Decomp MB/s");
+
+    for (auto &group : results) {
+        for (auto &codec : group.second) {
+            Print_Stats(group.first.empty() ? "all" : group.first.c_str(), s_benchCodecs[codec.first], codec.second);
+            failed = failed || codec.second.failures != 0;
+        }
+    }
+
+    if (refpack.baseline_seconds > 0.0 && refpack.unchecked_seconds > 0.0 && refpack.checked_seconds > 0.0) {
+        double megabytes = double(refpack.bytes) / (1024.0 * 1024.0);
+        printf("\nRefPack decode MB/s, byte at a time baseline %.1f, unchecked %.1f, checked %.1f\n",
+            megabytes / refpack.baseline_seconds,
+            megabytes / refpack.unchecked_seconds,
+            megabytes / refpack.checked_seconds);
+    }
+
+    return failed ? 1 : 0;
+}
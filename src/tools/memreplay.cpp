@@ -0,0 +1,388 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Replays a memory trace recorded by MemoryTrace against the memory pool implementation.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "critsection.h"
+#include "gamememoryinit.h"
+#include "memdynalloc.h"
+#include "mempool.h"
+#include "mempoolcache.h"
+#include "mempoolfact.h"
+#include "memtrace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+using std::atoi;
+using std::fclose;
+using std::fopen;
+using std::fread;
+using std::memcmp;
+using std::memcpy;
+using std::memset;
+using std::printf;
+using std::strcmp;
+
+namespace
+{
+enum
+{
+    SAMPLE_INTERVAL = 1024, // Events between footprint samples.
+    DEFAULT_POOL_COUNT = 32, // Block counts for pools the user tables don't know about.
+};
+
+struct ReplayBlock
+{
+    void *ptr;
+    MemoryPool *pool; // nullptr for blocks from the dynamic memory allocator.
+    int bytes;
+    int actual_bytes;
+};
+
+struct ReplayStats
+{
+    int64_t events;
+    int64_t allocs;
+    int64_t frees;
+    int64_t unmatched_frees;
+    int64_t live_bytes;
+    int64_t live_actual_bytes;
+    int64_t raw_bytes;
+    int64_t peak_footprint;
+    int64_t peak_live_bytes;
+    double seconds;
+};
+
+class TraceReader
+{
+public:
+    TraceReader(const std::vector<uint8_t> &data) : m_data(data), m_pos(0) {}
+
+    bool At_End() const { return m_pos >= m_data.size(); }
+
+    template<typename T> bool Read(T &value)
+    {
+        if (m_pos + sizeof(T) > m_data.size()) {
+            return false;
+        }
+
+        memcpy(&value, &m_data[m_pos], sizeof(T));
+        m_pos += sizeof(T);
+
+        return true;
+    }
+
+    bool Read_String(char *dest, int length)
+    {
+        if (m_pos + length > m_data.size()) {
+            return false;
+        }
+
+        memcpy(dest, &m_data[m_pos], length);
+        dest[length] = '\0';
+        m_pos += length;
+
+        return true;
+    }
+
+private:
+    const std::vector<uint8_t> &m_data;
+    size_t m_pos;
+};
+
+bool Load_Trace(const char *filename, std::vector<uint8_t> &data)
+{
+    FILE *fp = fopen(filename, "rb");
+
+    if (fp == nullptr) {
+        printf("Failed to open '%s'.\n", filename);
+
+        return false;
+    }
+
+    uint8_t buffer[64 * 1024];
+    size_t read;
+
+    while ((read = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+        data.insert(data.end(), buffer, buffer + read);
+    }
+
+    fclose(fp);
+
+    int32_t version = 0;
+
+    if (data.size() < sizeof(MemoryTrace::TRACE_MAGIC) + sizeof(version)
+        || memcmp(&data[0], MemoryTrace::TRACE_MAGIC, sizeof(MemoryTrace::TRACE_MAGIC)) != 0) {
+        printf("'%s' is not a memory trace.\n", filename);
+
+        return false;
+    }
+
+    memcpy(&version, &data[sizeof(MemoryTrace::TRACE_MAGIC)], sizeof(version));
+
+    if (version != MemoryTrace::TRACE_VERSION) {
+        printf("'%s' is trace version %d, expected %d.\n", filename, version, MemoryTrace::TRACE_VERSION);
+
+        return false;
+    }
+
+    return true;
+}
+
+MemoryPool *Create_Replay_Pool(MemoryPoolFactory *factory, const char *name, int size)
+{
+    int count = 0;
+    int overflow = 0;
+    User_Memory_Adjust_Pool_Size(name, count, overflow);
+
+    if (count <= 0 || overflow <= 0) {
+        count = DEFAULT_POOL_COUNT;
+        overflow = DEFAULT_POOL_COUNT;
+    }
+
+    return factory->Create_Memory_Pool(name, size, count, overflow);
+}
+
+void Sample_Footprint(MemoryPoolFactory *factory, ReplayStats &stats)
+{
+    int64_t footprint = factory->Get_Reserved_Bytes() + stats.raw_bytes;
+    stats.peak_footprint = std::max(stats.peak_footprint, footprint);
+    stats.peak_live_bytes = std::max(stats.peak_live_bytes, stats.live_bytes);
+}
+
+/**
+ * @brief Runs every event in a trace against a freshly created factory and dynamic memory allocator.
+ */
+bool Replay_Trace(const std::vector<uint8_t> &data, ReplayStats &stats)
+{
+    int dma_count;
+    PoolInitRec const *dma_params;
+    User_Memory_Get_DMA_Params(&dma_count, &dma_params);
+    MemoryPoolFactory *factory = new MemoryPoolFactory;
+    factory->Init();
+    DynamicMemoryAllocator *dma = factory->Create_Dynamic_Memory_Allocator(dma_count, dma_params);
+
+    // Pools keep a pointer to their name so the names must outlive the factory.
+    std::vector<char *> names;
+    std::vector<MemoryPool *> pools;
+    std::unordered_map<uint64_t, ReplayBlock> blocks;
+    blocks.reserve(1 << 20);
+    memset(&stats, 0, sizeof(stats));
+
+    TraceReader reader(data);
+    uint8_t skip[sizeof(MemoryTrace::TRACE_MAGIC) + sizeof(int32_t)];
+
+    for (size_t i = 0; i < sizeof(skip); ++i) {
+        reader.Read(skip[i]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = true;
+
+    while (ok && !reader.At_End()) {
+        uint8_t event;
+        uint32_t id;
+        uint32_t size;
+        uint64_t address;
+        ok = reader.Read(event);
+
+        switch (event) {
+            case MemoryTrace::EVENT_POOL: {
+                uint8_t name_len;
+                ok = ok && reader.Read(id) && reader.Read(size) && reader.Read(name_len);
+                char *name = new char[name_len + 1];
+                ok = ok && reader.Read_String(name, name_len);
+                names.push_back(name);
+
+                if (ok) {
+                    if (id >= pools.size()) {
+                        pools.resize(id + 1, nullptr);
+                    }
+
+                    pools[id] = Create_Replay_Pool(factory, name, size);
+                }
+
+                break;
+            }
+            case MemoryTrace::EVENT_POOL_ALLOC:
+            case MemoryTrace::EVENT_DMA_ALLOC: {
+                ReplayBlock block;
+
+                if (event == MemoryTrace::EVENT_POOL_ALLOC) {
+                    ok = ok && reader.Read(id) && reader.Read(address) && id < pools.size() && pools[id] != nullptr;
+
+                    if (!ok) {
+                        break;
+                    }
+
+                    block.pool = pools[id];
+                    block.ptr = block.pool->Allocate_Block_No_Zero();
+                    block.bytes = block.pool->Get_Alloc_Size();
+                    block.actual_bytes = block.bytes;
+                } else {
+                    ok = ok && reader.Read(size) && reader.Read(address);
+
+                    if (!ok) {
+                        break;
+                    }
+
+                    block.pool = nullptr;
+                    block.ptr = dma->Allocate_Bytes_No_Zero(size);
+                    block.bytes = size;
+                    block.actual_bytes = dma->Get_Actual_Allocation_Size(size);
+
+                    // Sizes no pool covers are served straight from the heap.
+                    if (dma->Find_Pool_For_Size(size) == nullptr) {
+                        stats.raw_bytes += size;
+                    }
+                }
+
+                blocks[address] = block;
+                stats.live_bytes += block.bytes;
+                stats.live_actual_bytes += block.actual_bytes;
+                ++stats.allocs;
+                break;
+            }
+            case MemoryTrace::EVENT_POOL_FREE:
+            case MemoryTrace::EVENT_DMA_FREE: {
+                if (event == MemoryTrace::EVENT_POOL_FREE) {
+                    ok = ok && reader.Read(id);
+                }
+
+                ok = ok && reader.Read(address);
+
+                if (!ok) {
+                    break;
+                }
+
+                auto it = blocks.find(address);
+
+                // Blocks allocated before the trace started can't be replayed.
+                if (it == blocks.end()) {
+                    ++stats.unmatched_frees;
+                    break;
+                }
+
+                ReplayBlock &block = it->second;
+
+                if (block.pool != nullptr) {
+                    block.pool->Free_Block(block.ptr);
+                } else {
+                    if (dma->Find_Pool_For_Size(block.bytes) == nullptr) {
+                        stats.raw_bytes -= block.bytes;
+                    }
+
+                    dma->Free_Bytes(block.ptr);
+                }
+
+                stats.live_bytes -= block.bytes;
+                stats.live_actual_bytes -= block.actual_bytes;
+                blocks.erase(it);
+                ++stats.frees;
+                break;
+            }
+            default:
+                printf("Unknown event %d in trace.\n", event);
+                ok = false;
+                break;
+        }
+
+        if (ok && ++stats.events % SAMPLE_INTERVAL == 0) {
+            Sample_Footprint(factory, stats);
+        }
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Sample_Footprint(factory, stats);
+
+    if (!ok) {
+        printf("Trace is truncated or corrupt after %lld events.\n", (long long)stats.events);
+    }
+
+    // Release whatever the trace never freed so the pools can be destroyed.
+    for (auto &entry : blocks) {
+        if (entry.second.pool != nullptr) {
+            entry.second.pool->Free_Block(entry.second.ptr);
+        } else {
+            dma->Free_Bytes(entry.second.ptr);
+        }
+    }
+
+    MemoryPoolThreadCache::Flush_Current_Thread();
+    delete factory;
+
+    for (char *name : names) {
+        delete[] name;
+    }
+
+    return ok;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        printf("Usage: %s <trace file> [repeat count]\n", argv[0]);
+
+        return 1;
+    }
+
+    int repeats = argc > 2 ? std::max(1, atoi(argv[2])) : 1;
+    std::vector<uint8_t> data;
+
+    if (!Load_Trace(argv[1], data)) {
+        return 1;
+    }
+
+    SimpleCriticalSectionClass dma_cs;
+    SimpleCriticalSectionClass pool_cs;
+    g_dmaCriticalSection = &dma_cs;
+    g_memoryPoolCriticalSection = &pool_cs;
+
+    ReplayStats best;
+    bool ok = true;
+
+    for (int i = 0; i < repeats && ok; ++i) {
+        ReplayStats stats;
+        ok = Replay_Trace(data, stats);
+
+        if (i == 0 || stats.seconds < best.seconds) {
+            best = stats;
+        }
+    }
+
+    double ops = double(best.allocs + best.frees);
+    double fragmentation = best.peak_footprint > 0 ? 1.0 - double(best.peak_live_bytes) / best.peak_footprint : 0.0;
+
+    printf("Events:          %lld (%lld allocs, %lld frees, %lld frees without an alloc)\n",
+        (long long)best.events,
+        (long long)best.allocs,
+        (long long)best.frees,
+        (long long)best.unmatched_frees);
+    printf("Replay time:     %.3f ms, best of %d\n", best.seconds * 1000.0, repeats);
+    printf("Throughput:      %.2f Mops/s, %.1f ns per op\n",
+        best.seconds > 0.0 ? ops / best.seconds / 1000000.0 : 0.0,
+        ops > 0.0 ? best.seconds * 1000000000.0 / ops : 0.0);
+    printf("Peak footprint:  %lld bytes\n", (long long)best.peak_footprint);
+    printf("Peak live bytes: %lld bytes\n", (long long)best.peak_live_bytes);
+    printf("Fragmentation:   %.1f%% of the peak footprint not holding live data\n", fragmentation * 100.0);
+
+    g_dmaCriticalSection = nullptr;
+    g_memoryPoolCriticalSection = nullptr;
+
+    return ok ? 0 : 1;
+}
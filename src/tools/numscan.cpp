@@ -0,0 +1,559 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Checks the locale independent number scanners against sscanf on every numeric token of a data directory.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "numberscan.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+using std::atoi;
+using std::fclose;
+using std::fopen;
+using std::fread;
+using std::memcmp;
+using std::printf;
+using std::snprintf;
+using std::sscanf;
+using std::strchr;
+using std::strcmp;
+
+namespace
+{
+struct Token
+{
+    std::string text;
+    const std::string *file;
+    int line;
+};
+
+struct Results
+{
+    int float_mismatches;
+    int int_mismatches;
+    int uint_mismatches;
+    int int_wrapped; // Past the range of the type, checked against the wrapped value instead of sscanf.
+    int uint_wrapped;
+    int reported;
+    int max_reported;
+};
+
+/**
+ * @brief A known answer for one of the places the scanners deliberately differ from sscanf.
+ */
+struct FloatAnswer
+{
+    const char *text;
+    float value;
+    int length;
+};
+
+struct IntAnswer
+{
+    const char *text;
+    int32_t value;
+};
+
+struct UIntAnswer
+{
+    const char *text;
+    uint32_t value;
+};
+
+bool Is_Digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+bool Same_Float(float left, float right)
+{
+    return memcmp(&left, &right, sizeof(float)) == 0 || (std::isnan(left) && std::isnan(right));
+}
+
+/**
+ * @brief Works out the magnitude of an integer token independently of the scanner, saturated and wrapped to 32 bits.
+ */
+bool Reference_Integer(const char *str, bool &negative, uint64_t &magnitude, uint32_t &wrapped)
+{
+    const char *c = str;
+
+    while (*c == ' ' || *c == '\t') {
+        ++c;
+    }
+
+    negative = *c == '-';
+
+    if (*c == '+' || *c == '-') {
+        ++c;
+    }
+
+    if (!Is_Digit(*c)) {
+        return false;
+    }
+
+    magnitude = 0;
+    wrapped = 0;
+
+    for (; Is_Digit(*c); ++c) {
+        magnitude = magnitude > UINT64_MAX / 100 ? UINT64_MAX / 10 : magnitude * 10 + uint64_t(*c - '0');
+        wrapped = wrapped * 10 + uint32_t(*c - '0');
+    }
+
+    if (negative) {
+        wrapped = 0u - wrapped;
+    }
+
+    return true;
+}
+
+void Report(Results &results, const Token &token, const char *kind, const char *scanned, const char *expected)
+{
+    if (results.reported++ < results.max_reported) {
+        printf("%s:%d: %s '%s' scanned as %s, expected %s.\n",
+            token.file->c_str(),
+            token.line,
+            kind,
+            token.text.c_str(),
+            scanned,
+            expected);
+    }
+}
+
+void Check_Float(const Token &token, Results &results)
+{
+    const char *str = token.text.c_str();
+    float value = 0.0f;
+    float expected = 0.0f;
+    int length = -1;
+    const char *end = rts::Scan_Float(str, value);
+    bool found = sscanf(str, "%f%n", &expected, &length) == 1;
+    bool same = (end != nullptr) == found && (!found || Same_Float(value, expected));
+
+    // sscanf also consumes a dangling exponent marker such as the e in "1e", callers only look at the value.
+    if (same && found && end - str != length && token.text.find_first_of("eE") == std::string::npos) {
+        same = false;
+    }
+
+    if (!same) {
+        char scanned[64] = "nothing";
+        char reference[64] = "nothing";
+
+        if (end != nullptr) {
+            snprintf(scanned, sizeof(scanned), "%.9g (length %d)", value, int(end - str));
+        }
+
+        if (found) {
+            snprintf(reference, sizeof(reference), "%.9g (length %d)", expected, length);
+        }
+
+        ++results.float_mismatches;
+        Report(results, token, "float", scanned, reference);
+    }
+}
+
+void Check_Int32(const Token &token, Results &results)
+{
+    const char *str = token.text.c_str();
+    int32_t value = 0;
+    int expected = 0;
+    int length = -1;
+    const char *end = rts::Scan_Int32(str, value);
+    bool negative;
+    uint64_t magnitude;
+    uint32_t wrapped;
+    bool found = Reference_Integer(str, negative, magnitude, wrapped);
+
+    if (found && magnitude > (negative ? 2147483648ull : 2147483647ull)) {
+        // Out of range is undefined for sscanf and glibc clamps to the range of long, the scanner wraps instead.
+        expected = int32_t(wrapped);
+        length = int(token.text.find_first_not_of("0123456789", token.text.find_first_of("0123456789")));
+        length = length < 0 ? int(token.text.size()) : length;
+        ++results.int_wrapped;
+    } else {
+        found = sscanf(str, "%d%n", &expected, &length) == 1;
+    }
+
+    if ((end != nullptr) != found || (found && (value != expected || end - str != length))) {
+        char scanned[64] = "nothing";
+        char reference[64] = "nothing";
+
+        if (end != nullptr) {
+            snprintf(scanned, sizeof(scanned), "%d (length %d)", value, int(end - str));
+        }
+
+        if (found) {
+            snprintf(reference, sizeof(reference), "%d (length %d)", expected, length);
+        }
+
+        ++results.int_mismatches;
+        Report(results, token, "int", scanned, reference);
+    }
+}
+
+void Check_UInt32(const Token &token, Results &results)
+{
+    const char *str = token.text.c_str();
+    uint32_t value = 0;
+    unsigned expected = 0;
+    int length = -1;
+    const char *end = rts::Scan_UInt32(str, value);
+    bool negative;
+    uint64_t magnitude;
+    uint32_t wrapped;
+    bool found = Reference_Integer(str, negative, magnitude, wrapped);
+
+    if (found && magnitude > UINT32_MAX) {
+        expected = wrapped;
+        length = int(token.text.find_first_not_of("0123456789", token.text.find_first_of("0123456789")));
+        length = length < 0 ? int(token.text.size()) : length;
+        ++results.uint_wrapped;
+    } else {
+        found = sscanf(str, "%u%n", &expected, &length) == 1;
+    }
+
+    if ((end != nullptr) != found || (found && (value != expected || end - str != length))) {
+        char scanned[64] = "nothing";
+        char reference[64] = "nothing";
+
+        if (end != nullptr) {
+            snprintf(scanned, sizeof(scanned), "%u (length %d)", value, int(end - str));
+        }
+
+        if (found) {
+            snprintf(reference, sizeof(reference), "%u (length %d)", expected, length);
+        }
+
+        ++results.uint_mismatches;
+        Report(results, token, "unsigned int", scanned, reference);
+    }
+}
+
+/**
+ * @brief Checks the exponent clamp and integer wrapping, where the scanners are defined but sscanf isn't or differs.
+ */
+bool Run_Known_Answers()
+{
+    std::string digits(300, '7');
+    std::string zeros(300, '0');
+    std::string long_exponent = "1e" + std::string(40, '9');
+    std::string long_negative_exponent = "1e-" + std::string(40, '9');
+    std::string many_digits = digits + "e-100000000";
+    std::string many_places = "0." + zeros + "1e310";
+
+    // Exponents are clamped at 100000 while they are read, which is far past anything a float can hold but keeps
+    // exponents of any length from overflowing.
+    const FloatAnswer float_answers[] = {
+        { "1e100000", INFINITY, 8 },
+        { "-1e100000", -INFINITY, 9 },
+        { "1e-100000", 0.0f, 9 },
+        { "-1e-100000", -0.0f, 10 },
+        { "1e100000000", INFINITY, 11 },
+        { "1e-100000000", 0.0f, 12 },
+        { "1e2147483648", INFINITY, 12 },
+        { "1e4294967297", INFINITY, 12 },
+        { "1e-4294967297", 0.0f, 13 },
+        { long_exponent.c_str(), INFINITY, int(long_exponent.size()) },
+        { long_negative_exponent.c_str(), 0.0f, int(long_negative_exponent.size()) },
+        { many_digits.c_str(), 0.0f, int(many_digits.size()) },
+        { many_places.c_str(), 1e9f, int(many_places.size()) },
+    };
+
+    const IntAnswer int_answers[] = {
+        { "2147483647", INT32_MAX },
+        { "-2147483648", INT32_MIN },
+        { "2147483648", INT32_MIN },
+        { "-2147483649", INT32_MAX },
+        { "4294967295", -1 },
+        { "4294967296", 0 },
+        { "4294967297", 1 },
+        { "99999999999999999999", 1661992959 },
+    };
+
+    const UIntAnswer uint_answers[] = {
+        { "4294967295", UINT32_MAX },
+        { "4294967296", 0 },
+        { "4294967297", 1 },
+        { "-1", UINT32_MAX },
+        { "-4294967295", 1 },
+        { "99999999999999999999", 1661992959 },
+    };
+
+    bool passed = true;
+
+    for (const FloatAnswer &answer : float_answers) {
+        float value = 0.0f;
+        const char *end = rts::Scan_Float(answer.text, value);
+
+        if (end == nullptr || end - answer.text != answer.length || !Same_Float(value, answer.value)) {
+            printf("Known answer failed: float '%.40s' scanned as %.9g, expected %.9g.\n", answer.text, value, answer.value);
+            passed = false;
+        }
+    }
+
+    for (const IntAnswer &answer : int_answers) {
+        int32_t value = 0;
+        const char *end = rts::Scan_Int32(answer.text, value);
+
+        if (end == nullptr || *end != '\0' || value != answer.value) {
+            printf("Known answer failed: int '%s' scanned as %d, expected %d.\n", answer.text, value, answer.value);
+            passed = false;
+        }
+    }
+
+    for (const UIntAnswer &answer : uint_answers) {
+        uint32_t value = 0;
+        const char *end = rts::Scan_UInt32(answer.text, value);
+
+        if (end == nullptr || *end != '\0' || value != answer.value) {
+            printf("Known answer failed: unsigned int '%s' scanned as %u, expected %u.\n", answer.text, value, answer.value);
+            passed = false;
+        }
+    }
+
+    return passed;
+}
+
+bool Load_File(const std::string &filename, std::string &data)
+{
+    FILE *fp = fopen(filename.c_str(), "rb");
+
+    if (fp == nullptr) {
+        return false;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    data.resize(size > 0 ? size : 0);
+    bool read = data.empty() || fread(&data[0], 1, data.size(), fp) == data.size();
+    fclose(fp);
+
+    return read;
+}
+
+/**
+ * @brief Splits an INI file on the separators the parser uses and keeps every token that starts like a number.
+ */
+void Load_Tokens(const std::string &data, const std::string *file, std::vector<Token> &tokens)
+{
+    static const char separators[] = " \n\r\t=:,";
+    int line = 1;
+    bool comment = false;
+    size_t pos = 0;
+
+    while (pos < data.size()) {
+        char c = data[pos];
+
+        if (c == '\n') {
+            ++line;
+            comment = false;
+        }
+
+        if (comment || strchr(separators, c) != nullptr || c == '\0') {
+            ++pos;
+            continue;
+        }
+
+        if (c == ';') {
+            comment = true;
+            ++pos;
+            continue;
+        }
+
+        size_t start = pos;
+
+        while (pos < data.size() && data[pos] != ';' && data[pos] != '\0' && strchr(separators, data[pos]) == nullptr) {
+            ++pos;
+        }
+
+        const char *text = data.c_str() + start;
+        const char *number = (*text == '+' || *text == '-') ? text + 1 : text;
+
+        if (Is_Digit(number[0]) || (number[0] == '.' && Is_Digit(number[1]))) {
+            tokens.push_back({ data.substr(start, pos - start), file, line });
+        }
+    }
+}
+
+void Scan_Directory(const std::string &dir, std::vector<std::string> &files)
+{
+    std::vector<std::string> names;
+    std::vector<std::string> dirs;
+
+#ifdef PLATFORM_WINDOWS
+    WIN32_FIND_DATAA find_data;
+    HANDLE handle = FindFirstFileA((dir + "/*").c_str(), &find_data);
+
+    if (handle == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    do {
+        if (strcmp(find_data.cFileName, ".") == 0 || strcmp(find_data.cFileName, "..") == 0) {
+            continue;
+        }
+
+        if ((find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+            dirs.push_back(find_data.cFileName);
+        } else {
+            names.push_back(find_data.cFileName);
+        }
+    } while (FindNextFileA(handle, &find_data));
+
+    FindClose(handle);
+#else
+    DIR *dp = opendir(dir.c_str());
+
+    if (dp == nullptr) {
+        return;
+    }
+
+    for (dirent *entry = readdir(dp); entry != nullptr; entry = readdir(dp)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        struct stat info;
+
+        if (stat((dir + "/" + entry->d_name).c_str(), &info) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(info.st_mode)) {
+            dirs.push_back(entry->d_name);
+        } else {
+            names.push_back(entry->d_name);
+        }
+    }
+
+    closedir(dp);
+#endif
+
+    std::sort(names.begin(), names.end());
+    std::sort(dirs.begin(), dirs.end());
+
+    for (const std::string &name : names) {
+        std::string extension = name.size() > 4 ? name.substr(name.size() - 4) : std::string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) {
+            return (c >= 'A' && c <= 'Z') ? char(c + ('a' - 'A')) : c;
+        });
+
+        if (extension == ".ini") {
+            files.push_back(dir + "/" + name);
+        }
+    }
+
+    for (const std::string &name : dirs) {
+        Scan_Directory(dir + "/" + name, files);
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int max_reported = 50;
+    int first_arg = 1;
+
+    if (argc > 3 && strcmp(argv[1], "-m") == 0) {
+        max_reported = std::max(0, atoi(argv[2]));
+        first_arg = 3;
+    }
+
+    if (first_arg + 1 != argc) {
+        printf("Usage: %s [-m max mismatches reported] <data directory>\n", argv[0]);
+
+        return 1;
+    }
+
+    if (!Run_Known_Answers()) {
+        return 1;
+    }
+
+    std::vector<std::string> files;
+    Scan_Directory(argv[first_arg], files);
+
+    if (files.empty()) {
+        printf("No INI files found in '%s'.\n", argv[first_arg]);
+
+        return 1;
+    }
+
+    std::vector<std::string> contents(files.size());
+    std::vector<Token> tokens;
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (Load_File(files[i], contents[i])) {
+            Load_Tokens(contents[i], &files[i], tokens);
+        }
+    }
+
+    Results results = {};
+    results.max_reported = max_reported;
+
+    for (const Token &token : tokens) {
+        Check_Float(token, results);
+        Check_Int32(token, results);
+        Check_UInt32(token, results);
+    }
+
+    // Time both over the same tokens so the comparison reflects the numbers the game actually reads.
+    float scan_sum = 0.0f;
+    float sscanf_sum = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+
+    for (const Token &token : tokens) {
+        float value = 0.0f;
+        rts::Scan_Float(token.text.c_str(), value);
+        scan_sum += value;
+    }
+
+    auto middle = std::chrono::steady_clock::now();
+
+    for (const Token &token : tokens) {
+        float value = 0.0f;
+        sscanf(token.text.c_str(), "%f", &value);
+        sscanf_sum += value;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    double count = std::max(double(tokens.size()), 1.0);
+
+    if (results.reported > results.max_reported) {
+        printf("... %d more mismatches not shown.\n", results.reported - results.max_reported);
+    }
+
+    printf("\n%d numeric tokens in %d INI files.\n\n", int(tokens.size()), int(files.size()));
+    printf("%-14s %12s %12s\n", "Type", "Mismatches", "Wrapped");
+    printf("%-14s %12d %12s\n", "float", results.float_mismatches, "-");
+    printf("%-14s %12d %12d\n", "int", results.int_mismatches, results.int_wrapped);
+    printf("%-14s %12d %12d\n", "unsigned int", results.uint_mismatches, results.uint_wrapped);
+    printf("\nScan_Float %.1f ns, sscanf %.1f ns per token (sums %g, %g).\n",
+        std::chrono::duration<double, std::nano>(middle - start).count() / count,
+        std::chrono::duration<double, std::nano>(end - middle).count() / count,
+        scan_sum,
+        sscanf_sum);
+
+    return results.reported == 0 ? 0 : 1;
+}
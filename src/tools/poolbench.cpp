@@ -0,0 +1,236 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Measures the lock free ObjectPoolClass against the spin locked free list it replaced.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "autopool.h"
+#include "critsection.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using std::atoi;
+using std::printf;
+using std::strcmp;
+
+namespace
+{
+enum
+{
+    OBJECT_SIZE = 64,
+    POOL_BLOCK_SIZE = 256,
+    DEFAULT_OPERATIONS = 1000000, // Allocations per thread.
+    DEFAULT_BATCH = 16, // Objects each thread holds before freeing them again.
+};
+
+struct BenchObject
+{
+    char data[OBJECT_SIZE];
+};
+
+/**
+ * @brief The FastCriticalSectionClass guarded free list ObjectPoolClass used before it became lock free, kept as the
+ * baseline it is measured against.
+ */
+template<typename T, int BLOCK_SIZE>
+class SpinLockObjectPool
+{
+public:
+    SpinLockObjectPool() : m_freeListHead(nullptr), m_blockListHead(nullptr), m_freeObjectCount(0), m_totalObjectCount(0) {}
+
+    ~SpinLockObjectPool()
+    {
+        void *block = m_blockListHead;
+
+        while (block) {
+            void *nextBlock = *(void **)block;
+            delete[] (char *)block;
+            block = nextBlock;
+        }
+    }
+
+    T *Allocate_Object_Memory()
+    {
+        FastCriticalSectionClass::LockClass lock(m_poolCS);
+
+        if (m_freeListHead == nullptr) {
+            void *newBlockListHead = (void *)((void *)new char[sizeof(void *) + sizeof(T[BLOCK_SIZE])]);
+            *(void **)newBlockListHead = m_blockListHead;
+            m_blockListHead = newBlockListHead;
+            m_freeListHead = (T *)((intptr_t)m_blockListHead + sizeof(void *));
+
+            for (int i = 0; i < BLOCK_SIZE; i++) {
+                (T *&)m_freeListHead[i] = &m_freeListHead[i + 1];
+            }
+
+            (T *&)m_freeListHead[BLOCK_SIZE - 1] = nullptr;
+            m_freeObjectCount += BLOCK_SIZE;
+            m_totalObjectCount += BLOCK_SIZE;
+        }
+
+        T *object = m_freeListHead;
+        m_freeListHead = *(T **)(m_freeListHead);
+        m_freeObjectCount--;
+
+        return object;
+    }
+
+    void Free_Object_Memory(T *object)
+    {
+        FastCriticalSectionClass::LockClass lock(m_poolCS);
+        *(T **)(object) = m_freeListHead;
+        m_freeListHead = object;
+        m_freeObjectCount++;
+    }
+
+private:
+    T *m_freeListHead;
+    void *m_blockListHead;
+    int m_freeObjectCount;
+    int m_totalObjectCount;
+    FastCriticalSectionClass m_poolCS;
+};
+
+/**
+ * @brief Runs the same allocate and free pattern on every thread against one shared pool, returns the seconds taken
+ * or a negative value if two threads were ever handed the same object.
+ */
+template<typename Pool>
+double Run_Bench(int threads, int operations, int batch)
+{
+    Pool pool;
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+    std::atomic<bool> corrupt(false);
+    std::vector<std::thread> workers;
+
+    auto worker = [&](int id) {
+        std::vector<BenchObject *> held(batch);
+        ++ready;
+
+        while (!go.load(std::memory_order_acquire)) {
+        }
+
+        for (int done = 0; done < operations; done += batch) {
+            for (int i = 0; i < batch; ++i) {
+                held[i] = pool.Allocate_Object_Memory();
+                // The first word is the free list link, the tag goes after it.
+                held[i]->data[sizeof(void *)] = char(id);
+            }
+
+            for (int i = 0; i < batch; ++i) {
+                if (held[i]->data[sizeof(void *)] != char(id)) {
+                    corrupt = true;
+                }
+
+                pool.Free_Object_Memory(held[i]);
+            }
+        }
+    };
+
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back(worker, i);
+    }
+
+    while (ready.load() != threads) {
+        std::this_thread::yield();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+
+    for (std::thread &thread : workers) {
+        thread.join();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    return corrupt ? -1.0 : std::chrono::duration<double>(end - start).count();
+}
+
+/**
+ * @brief Best time out of several runs, one failed run fails the lot.
+ */
+template<typename Pool>
+double Best_Of(int repeats, int threads, int operations, int batch)
+{
+    double best = 0.0;
+
+    for (int i = 0; i < repeats; ++i) {
+        double seconds = Run_Bench<Pool>(threads, operations, batch);
+
+        if (seconds < 0.0) {
+            return seconds;
+        }
+
+        if (i == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+
+    return best;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int max_threads = std::max(int(std::thread::hardware_concurrency()), 1);
+    int operations = DEFAULT_OPERATIONS;
+    int batch = DEFAULT_BATCH;
+    int repeats = 3;
+
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            printf("Usage: %s [-t max threads] [-n allocations per thread] [-b batch size] [-r repeat count]\n", argv[0]);
+
+            return 1;
+        }
+
+        if (strcmp(argv[i], "-t") == 0) {
+            max_threads = std::max(1, atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "-n") == 0) {
+            operations = std::max(1, atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "-b") == 0) {
+            batch = std::max(1, atoi(argv[i + 1]));
+        } else if (strcmp(argv[i], "-r") == 0) {
+            repeats = std::max(1, atoi(argv[i + 1]));
+        } else {
+            printf("Unknown option '%s'.\n", argv[i]);
+
+            return 1;
+        }
+    }
+
+    printf("%-8s %16s %16s %8s\n", "Threads", "Spin lock Mop/s", "Lock free Mop/s", "Speedup");
+    bool failed = false;
+
+    for (int threads = 1; threads <= max_threads; ++threads) {
+        double allocations = double(threads) * operations / 1000000.0;
+        double locked = Best_Of<SpinLockObjectPool<BenchObject, POOL_BLOCK_SIZE>>(repeats, threads, operations, batch);
+        double lock_free = Best_Of<ObjectPoolClass<BenchObject, POOL_BLOCK_SIZE>>(repeats, threads, operations, batch);
+
+        if (locked < 0.0 || lock_free < 0.0) {
+            printf("%-8d %s handed the same object to two threads.\n", threads, locked < 0.0 ? "Spin lock" : "Lock free");
+            failed = true;
+            continue;
+        }
+
+        printf("%-8d %16.1f %16.1f %7.2fx\n", threads, allocations / locked, allocations / lock_free, locked / lock_free);
+    }
+
+    return failed ? 1 : 0;
+}
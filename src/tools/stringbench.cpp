@@ -0,0 +1,541 @@
+/**
+ * @file
+ *
+ * @author OmniBlade
+ *
+ * @brief Measures the vectorised string helpers against scalar loops on the paths and CSF strings of a data directory.
+ *
+ * @copyright Thyme is free software: you can redistribute it and/or
+ *            modify it under the terms of the GNU General Public License
+ *            as published by the Free Software Foundation, either version
+ *            2 of the License, or (at your option) any later version.
+ *            A full copy of the GNU General Public License can be found in
+ *            LICENSE
+ */
+#include "stringsimd.h"
+#include "endiantype.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#ifdef PLATFORM_WINDOWS
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+using std::atoi;
+using std::fclose;
+using std::fopen;
+using std::fread;
+using std::memcmp;
+using std::memcpy;
+using std::printf;
+using std::strcmp;
+
+namespace
+{
+struct StringSets
+{
+    std::vector<std::string> paths;
+    std::vector<std::string> labels;
+    std::vector<std::vector<unichar_t>> texts; // Null terminated, already decoded.
+    int64_t path_bytes;
+    int64_t label_bytes;
+    int64_t text_chars;
+};
+
+/**
+ * @brief A kernel run over a whole string set, the result is compared between the two versions.
+ */
+struct Kernel
+{
+    const char *name;
+    const int64_t *bytes;
+    std::function<uint64_t()> simd;
+    std::function<uint64_t()> scalar;
+};
+
+unsigned char Fold(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : (unsigned char)c;
+}
+
+int Sign(int value)
+{
+    return (value > 0) - (value < 0);
+}
+
+uint64_t Mix(uint64_t hash, uint64_t value)
+{
+    return (hash ^ value) * 1099511628211ull;
+}
+
+int Scalar_Compare_No_Case(const char *left, const char *right)
+{
+    for (;;) {
+        int l = Fold(*left++);
+        int r = Fold(*right++);
+
+        if (l != r || l == 0) {
+            return l - r;
+        }
+    }
+}
+
+bool Load_File(const std::string &filename, std::vector<uint8_t> &data)
+{
+    FILE *fp = fopen(filename.c_str(), "rb");
+
+    if (fp == nullptr) {
+        return false;
+    }
+
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    data.resize(size > 0 ? size : 0);
+    bool read = data.empty() || fread(data.data(), 1, data.size(), fp) == data.size();
+    fclose(fp);
+
+    return read;
+}
+
+/**
+ * @brief Adds the labels and first strings of a CSF file, stops quietly at anything it doesn't understand.
+ */
+void Load_CSF(const std::string &filename, StringSets &sets)
+{
+    std::vector<uint8_t> data;
+
+    if (!Load_File(filename, data) || data.size() < 24 || memcmp(data.data(), " FSC", 4) != 0) {
+        return;
+    }
+
+    size_t pos = 24;
+
+    auto read_int = [&](int32_t &value) {
+        if (pos + 4 > data.size()) {
+            return false;
+        }
+
+        memcpy(&value, &data[pos], 4);
+        value = le32toh(value);
+        pos += 4;
+
+        return true;
+    };
+
+    while (pos + 4 <= data.size() && memcmp(&data[pos], " LBL", 4) == 0) {
+        int32_t string_count;
+        int32_t length;
+        pos += 4;
+
+        if (!read_int(string_count) || !read_int(length) || length < 0 || pos + length > data.size()) {
+            return;
+        }
+
+        sets.labels.emplace_back(reinterpret_cast<const char *>(&data[pos]), length);
+        sets.label_bytes += length;
+        pos += length;
+
+        for (int i = 0; i < string_count; ++i) {
+            if (pos + 4 > data.size() || (memcmp(&data[pos], " RTS", 4) != 0 && memcmp(&data[pos], "WRTS", 4) != 0)) {
+                return;
+            }
+
+            bool extra = data[pos] == 'W';
+            pos += 4;
+
+            if (!read_int(length) || length < 0 || pos + size_t(length) * 2 > data.size()) {
+                return;
+            }
+
+            std::vector<unichar_t> text(length + 1, 0);
+
+            for (int j = 0; j < length; ++j) {
+                uint16_t c;
+                memcpy(&c, &data[pos + j * 2], 2);
+                text[j] = unichar_t(uint16_t(~le16toh(c)));
+            }
+
+            pos += size_t(length) * 2;
+            sets.text_chars += length;
+            sets.texts.push_back(text);
+
+            if (extra) {
+                if (!read_int(length) || length < 0 || pos + length > data.size()) {
+                    return;
+                }
+
+                pos += length;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Collects the path of every file below a directory named the way the game names them, with backslashes and
+ * relative to the data directory. CSF files are also parsed for their strings.
+ */
+void Scan_Directory(const std::string &dir, const std::string &prefix, StringSets &sets)
+{
+    std::vector<std::string> names;
+    std::vector<std::string> dirs;
+
+#ifdef PLATFORM_WINDOWS
+    WIN32_FIND_DATAA find_data;
+    HANDLE handle = FindFirstFileA((dir + "/*").c_str(), &find_data);
+
+    if (handle == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    do {
+        if (strcmp(find_data.cFileName, ".") == 0 || strcmp(find_data.cFileName, "..") == 0) {
+            continue;
+        }
+
+        if ((find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+            dirs.push_back(find_data.cFileName);
+        } else {
+            names.push_back(find_data.cFileName);
+        }
+    } while (FindNextFileA(handle, &find_data));
+
+    FindClose(handle);
+#else
+    DIR *dp = opendir(dir.c_str());
+
+    if (dp == nullptr) {
+        return;
+    }
+
+    for (dirent *entry = readdir(dp); entry != nullptr; entry = readdir(dp)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+
+        struct stat info;
+
+        if (stat((dir + "/" + entry->d_name).c_str(), &info) != 0) {
+            continue;
+        }
+
+        if (S_ISDIR(info.st_mode)) {
+            dirs.push_back(entry->d_name);
+        } else {
+            names.push_back(entry->d_name);
+        }
+    }
+
+    closedir(dp);
+#endif
+
+    for (const std::string &name : names) {
+        sets.paths.push_back(prefix + name);
+        sets.path_bytes += prefix.size() + name.size();
+
+        if (name.size() > 4 && Scalar_Compare_No_Case(name.c_str() + name.size() - 4, ".csf") == 0) {
+            Load_CSF(dir + "/" + name, sets);
+        }
+    }
+
+    for (const std::string &name : dirs) {
+        Scan_Directory(dir + "/" + name, prefix + name + "\\", sets);
+    }
+}
+
+double Time_Best(int repeats, const std::function<uint64_t()> &run, uint64_t &result)
+{
+    double best = 0.0;
+
+    for (int i = 0; i < repeats; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        result = run();
+        auto end = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+
+        if (i == 0 || seconds < best) {
+            best = seconds;
+        }
+    }
+
+    return best;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int repeats = 5;
+    int first_arg = 1;
+
+    if (argc > 3 && strcmp(argv[1], "-r") == 0) {
+        repeats = std::max(1, atoi(argv[2]));
+        first_arg = 3;
+    }
+
+    if (first_arg + 1 != argc) {
+        printf("Usage: %s [-r repeat count] <data directory>\n", argv[0]);
+
+        return 1;
+    }
+
+    StringSets sets = {};
+    Scan_Directory(argv[first_arg], "", sets);
+
+    if (sets.paths.empty()) {
+        printf("No files found in '%s'.\n", argv[first_arg]);
+
+        return 1;
+    }
+
+    // Lookups compare a path against an entry that differs only in case or against its neighbour in sorted order.
+    std::vector<std::string> upper_paths = sets.paths;
+
+    for (std::string &path : upper_paths) {
+        std::transform(path.begin(), path.end(), path.begin(), [](char c) {
+            return (c >= 'a' && c <= 'z') ? char(c - ('a' - 'A')) : c;
+        });
+    }
+
+    std::vector<std::string> sorted_paths = sets.paths;
+    std::sort(sorted_paths.begin(), sorted_paths.end());
+    std::vector<std::string> sorted_labels = sets.labels;
+    std::sort(sorted_labels.begin(), sorted_labels.end());
+    std::vector<char> scratch;
+    std::vector<unichar_t> wide_scratch;
+
+    for (const std::string &path : sets.paths) {
+        scratch.resize(std::max(scratch.size(), path.size() + 1));
+        wide_scratch.resize(std::max(wide_scratch.size(), path.size() + 1));
+    }
+
+    for (const std::vector<unichar_t> &text : sets.texts) {
+        scratch.resize(std::max(scratch.size(), text.size()));
+    }
+
+    printf("%d paths (%lld bytes), %d CSF labels (%lld bytes), %d CSF strings (%lld characters).\n\n",
+        int(sets.paths.size()),
+        (long long)sets.path_bytes,
+        int(sets.labels.size()),
+        (long long)sets.label_bytes,
+        int(sets.texts.size()),
+        (long long)sets.text_chars);
+
+    int64_t text_bytes = sets.text_chars * 2;
+    std::vector<Kernel> kernels;
+
+    kernels.push_back({ "Has_Upper_Ascii paths",
+        &sets.path_bytes,
+        [&]() {
+            uint64_t count = 0;
+
+            for (const std::string &path : sets.paths) {
+                count += rts::Has_Upper_Ascii(path.data(), int(path.size()));
+            }
+
+            return count;
+        },
+        [&]() {
+            uint64_t count = 0;
+
+            for (const std::string &path : sets.paths) {
+                count += std::any_of(path.begin(), path.end(), [](char c) { return c >= 'A' && c <= 'Z'; });
+            }
+
+            return count;
+        } });
+
+    kernels.push_back({ "To_Lower_Ascii paths",
+        &sets.path_bytes,
+        [&]() {
+            uint64_t hash = 0;
+
+            for (const std::string &path : sets.paths) {
+                memcpy(scratch.data(), path.data(), path.size());
+                rts::To_Lower_Ascii(scratch.data(), int(path.size()));
+                hash = Mix(hash, uint8_t(scratch[path.size() / 2]));
+            }
+
+            return hash;
+        },
+        [&]() {
+            uint64_t hash = 0;
+
+            for (const std::string &path : sets.paths) {
+                memcpy(scratch.data(), path.data(), path.size());
+
+                for (size_t i = 0; i < path.size(); ++i) {
+                    scratch[i] = char(Fold(scratch[i]));
+                }
+
+                hash = Mix(hash, uint8_t(scratch[path.size() / 2]));
+            }
+
+            return hash;
+        } });
+
+    kernels.push_back({ "Compare_No_Case equal paths",
+        &sets.path_bytes,
+        [&]() {
+            uint64_t hash = 0;
+
+            for (size_t i = 0; i < sets.paths.size(); ++i) {
+                hash = Mix(hash, Sign(rts::Compare_No_Case(sets.paths[i].c_str(), upper_paths[i].c_str())) + 1);
+            }
+
+            return hash;
+        },
+        [&]() {
+            uint64_t hash = 0;
+
+            for (size_t i = 0; i < sets.paths.size(); ++i) {
+                hash = Mix(hash, Sign(Scalar_Compare_No_Case(sets.paths[i].c_str(), upper_paths[i].c_str())) + 1);
+            }
+
+            return hash;
+        } });
+
+    kernels.push_back({ "Compare_No_Case sorted paths",
+        &sets.path_bytes,
+        [&]() {
+            uint64_t hash = 0;
+
+            for (size_t i = 1; i < sorted_paths.size(); ++i) {
+                hash = Mix(hash, Sign(rts::Compare_No_Case(sorted_paths[i - 1].c_str(), sorted_paths[i].c_str())) + 1);
+            }
+
+            return hash;
+        },
+        [&]() {
+            uint64_t hash = 0;
+
+            for (size_t i = 1; i < sorted_paths.size(); ++i) {
+                hash = Mix(hash, Sign(Scalar_Compare_No_Case(sorted_paths[i - 1].c_str(), sorted_paths[i].c_str())) + 1);
+            }
+
+            return hash;
+        } });
+
+    kernels.push_back({ "Compare_No_Case CSF labels",
+        &sets.label_bytes,
+        [&]() {
+            uint64_t hash = 0;
+
+            for (size_t i = 1; i < sorted_labels.size(); ++i) {
+                hash = Mix(hash, Sign(rts::Compare_No_Case(sorted_labels[i - 1].c_str(), sorted_labels[i].c_str())) + 1);
+            }
+
+            return hash;
+        },
+        [&]() {
+            uint64_t hash = 0;
+
+            for (size_t i = 1; i < sorted_labels.size(); ++i) {
+                hash = Mix(hash, Sign(Scalar_Compare_No_Case(sorted_labels[i - 1].c_str(), sorted_labels[i].c_str())) + 1);
+            }
+
+            return hash;
+        } });
+
+    kernels.push_back({ "Widen_Ascii paths",
+        &sets.path_bytes,
+        [&]() {
+            uint64_t hash = 0;
+
+            for (const std::string &path : sets.paths) {
+                rts::Widen_Ascii(wide_scratch.data(), path.data(), int(path.size()));
+                hash = Mix(hash, wide_scratch[path.size() / 2]);
+            }
+
+            return hash;
+        },
+        [&]() {
+            uint64_t hash = 0;
+
+            for (const std::string &path : sets.paths) {
+                for (size_t i = 0; i < path.size(); ++i) {
+                    wide_scratch[i] = unichar_t((unsigned char)path[i]);
+                }
+
+                hash = Mix(hash, wide_scratch[path.size() / 2]);
+            }
+
+            return hash;
+        } });
+
+    // Translating CSF text checks for ASCII first and only narrows directly when it is.
+    kernels.push_back({ "Is_Ascii and Narrow_Ascii CSF",
+        &text_bytes,
+        [&]() {
+            uint64_t hash = 0;
+
+            for (const std::vector<unichar_t> &text : sets.texts) {
+                int len = int(text.size()) - 1;
+
+                if (rts::Is_Ascii(text.data(), len)) {
+                    rts::Narrow_Ascii(scratch.data(), text.data(), len);
+                    hash = Mix(hash, len > 0 ? uint8_t(scratch[len / 2]) : 0);
+                } else {
+                    hash = Mix(hash, 0x100);
+                }
+            }
+
+            return hash;
+        },
+        [&]() {
+            uint64_t hash = 0;
+
+            for (const std::vector<unichar_t> &text : sets.texts) {
+                int len = int(text.size()) - 1;
+
+                if (std::all_of(text.begin(), text.end() - 1, [](unichar_t c) { return unsigned(c) <= 0x7F; })) {
+                    for (int i = 0; i < len; ++i) {
+                        scratch[i] = char(text[i]);
+                    }
+
+                    hash = Mix(hash, len > 0 ? uint8_t(scratch[len / 2]) : 0);
+                } else {
+                    hash = Mix(hash, 0x100);
+                }
+            }
+
+            return hash;
+        } });
+
+    printf("%-32s %12s %12s %8s\n", "Kernel", "Scalar MB/s", "SIMD MB/s", "Speedup");
+    bool failed = false;
+
+    for (const Kernel &kernel : kernels) {
+        if (*kernel.bytes == 0) {
+            continue;
+        }
+
+        uint64_t simd_result;
+        uint64_t scalar_result;
+        double simd_seconds = Time_Best(repeats, kernel.simd, simd_result);
+        double scalar_seconds = Time_Best(repeats, kernel.scalar, scalar_result);
+        double megabytes = double(*kernel.bytes) / (1024.0 * 1024.0);
+
+        if (simd_result != scalar_result) {
+            printf("%-32s results differ between the SIMD and scalar versions.\n", kernel.name);
+            failed = true;
+            continue;
+        }
+
+        printf("%-32s %12.1f %12.1f %7.2fx\n",
+            kernel.name,
+            scalar_seconds > 0.0 ? megabytes / scalar_seconds : 0.0,
+            simd_seconds > 0.0 ? megabytes / simd_seconds : 0.0,
+            simd_seconds > 0.0 ? scalar_seconds / simd_seconds : 0.0);
+    }
+
+    return failed ? 1 : 0;
+}
@@ -19,6 +19,131 @@
 #include "critsection.h"
 #include <captainslog.h>
 
+#ifndef GAME_DLL
+#include <atomic>
+#endif
+
+#ifndef GAME_DLL
+/**
+ * @brief Lock free pool of fixed size objects.
+ *
+ * The free list is a Treiber stack. Its head packs the pointer together with a counter that changes on every update
+ * so a head that was popped and pushed back between reading it and the compare exchange is detected. Memory is only
+ * returned to the heap when the pool is destroyed, which keeps reading the next pointer of a stale head safe.
+ */
+template<typename T, int BLOCK_SIZE>
+class ObjectPoolClass
+{
+public:
+    ObjectPoolClass() : m_freeListHead(0), m_blockListHead(nullptr), m_freeObjectCount(0), m_totalObjectCount(0) {}
+
+    ~ObjectPoolClass()
+    {
+        // If you hit the following assert, one or more objects were not freed.
+        captainslog_dbgassert(
+            m_freeObjectCount == m_totalObjectCount, "Not all memory was returned to the pool before destruction.");
+
+        void *block = m_blockListHead;
+
+        while (block) {
+            void *nextBlock = *(void **)block;
+            delete[] (char *)block;
+            block = nextBlock;
+        }
+    }
+
+    T *Allocate_Object_Memory()
+    {
+        uint64_t head = m_freeListHead.load(std::memory_order_acquire);
+
+        for (;;) {
+            T *object = Unpack_Pointer(head);
+
+            // Grow our allocation if we haven't got any free space.
+            if (object == nullptr) {
+                return Allocate_Block();
+            }
+
+            T *next = *(T **)(object);
+
+            if (m_freeListHead.compare_exchange_weak(
+                    head, Pack_Head(next, head), std::memory_order_acq_rel, std::memory_order_acquire)) {
+                --m_freeObjectCount;
+
+                return object;
+            }
+        }
+    }
+
+    void Free_Object_Memory(T *object)
+    {
+        Push_List(object, object, 1);
+    }
+
+private:
+    enum
+    {
+        // Canonical user space addresses fit in 48 bits on 64bit targets, 32bit ones get a full word for the tag.
+        TAG_SHIFT = sizeof(void *) == 8 ? 48 : 32,
+    };
+
+    static uint64_t Pack_Head(T *object, uint64_t old_head)
+    {
+        uint64_t tag = (old_head >> TAG_SHIFT) + 1;
+
+        return (tag << TAG_SHIFT) | (uint64_t(uintptr_t(object)) & ((uint64_t(1) << TAG_SHIFT) - 1));
+    }
+
+    static T *Unpack_Pointer(uint64_t head)
+    {
+        return reinterpret_cast<T *>(uintptr_t(head & ((uint64_t(1) << TAG_SHIFT) - 1)));
+    }
+
+    void Push_List(T *first, T *last, int count)
+    {
+        uint64_t head = m_freeListHead.load(std::memory_order_relaxed);
+
+        do {
+            *(T **)(last) = Unpack_Pointer(head);
+        } while (!m_freeListHead.compare_exchange_weak(
+            head, Pack_Head(first, head), std::memory_order_release, std::memory_order_relaxed));
+
+        m_freeObjectCount += count;
+    }
+
+    T *Allocate_Block()
+    {
+        // Allocate enough space for our block plus space for a pointer to create a linked list.
+        void *newBlock = (void *)new char[sizeof(void *) + sizeof(T[BLOCK_SIZE])];
+        T *objects = (T *)((intptr_t)newBlock + sizeof(void *));
+        void *oldBlockListHead = m_blockListHead.load(std::memory_order_relaxed);
+
+        do {
+            *(void **)newBlock = oldBlockListHead;
+        } while (!m_blockListHead.compare_exchange_weak(
+            oldBlockListHead, newBlock, std::memory_order_release, std::memory_order_relaxed));
+
+        m_totalObjectCount += BLOCK_SIZE;
+
+        // Keep the first object for the caller and push the rest onto the free list in one go.
+        for (int i = 1; i < BLOCK_SIZE - 1; i++) {
+            (T *&)objects[i] = &objects[i + 1];
+        }
+
+        if (BLOCK_SIZE > 1) {
+            Push_List(&objects[1], &objects[BLOCK_SIZE - 1], BLOCK_SIZE - 1);
+        }
+
+        return &objects[0];
+    }
+
+private:
+    std::atomic<uint64_t> m_freeListHead;
+    std::atomic<void *> m_blockListHead;
+    std::atomic<int> m_freeObjectCount;
+    std::atomic<int> m_totalObjectCount;
+};
+#else
 template<typename T, int BLOCK_SIZE>
 class ObjectPoolClass
 {
@@ -29,7 +154,7 @@ public:
     {
         // If you hit the following assert, one or more objects were not freed.
         captainslog_dbgassert(
-            m_freeObjectCount != m_totalObjectCount, "Not all memory was returned to the pool before destruction.");
+            m_freeObjectCount == m_totalObjectCount, "Not all memory was returned to the pool before destruction.");
 
         void *block = m_blockListHead;
 
@@ -87,6 +212,7 @@ private:
     int m_totalObjectCount;
     FastCriticalSectionClass m_poolCS;
 };
+#endif
 
 template<typename T, unsigned BLOCKSIZE>
 class AutoPoolClass